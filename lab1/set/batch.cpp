@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include "Atom.h"
+#include "MappedFile.h"
+#include "SetEvaluator.h"
+#include "ThreadPool.h"
+
+// Пакетное вычисление: по одному литералу или выражению на строку.
+// Файл отображается в память и обрабатывается окнами; строки окна делятся
+// на куски по потокам, результаты пишутся в исходном порядке.
+namespace {
+
+const std::size_t WINDOW_BYTES = 64 << 20;
+char outputBuffer[1 << 20];
+
+struct Shard {
+    std::size_t begin;
+    std::size_t end;
+    std::size_t lines;
+    std::string output;
+};
+
+void evaluateShard(std::string_view text, Shard& shard) {
+    std::size_t pos = shard.begin;
+    while (pos < shard.end) {
+        std::size_t newline = text.find('\n', pos);
+        if (newline == std::string_view::npos || newline > shard.end) newline = shard.end;
+        std::string_view line = text.substr(pos, newline - pos);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        try {
+            shard.output += SetEvaluator::evaluate(line).serialize();
+        } catch (const std::exception& error) {
+            shard.output += "error: ";
+            shard.output += error.what();
+        }
+        shard.output += '\n';
+        ++shard.lines;
+        pos = newline + 1;
+    }
+}
+
+// Граница куска сдвигается к началу следующей строки
+std::size_t lineBoundary(std::string_view text, std::size_t pos, std::size_t limit) {
+    if (pos >= limit) return limit;
+    std::size_t newline = text.find('\n', pos);
+    return newline == std::string_view::npos || newline >= limit ? limit : newline + 1;
+}
+
+// Число потоков для -j: положительное целое без посторонних символов
+std::size_t parseThreads(const std::string& text) {
+    std::size_t used = 0;
+    unsigned long value = 0;
+    try {
+        value = std::stoul(text, &used);
+    } catch (const std::logic_error&) {
+        used = 0;
+    }
+    if (used == 0 || used != text.size() || value == 0) {
+        throw std::invalid_argument("некорректное число потоков: " + text);
+    }
+    return static_cast<std::size_t>(value);
+}
+
+void usage() {
+    std::cerr << "Использование: set_batch <входной файл> [выходной файл] [-j потоки]" << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::string inputPath;
+    std::string outputPath;
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    try {
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+                threads = parseThreads(argv[++i]);
+            } else if (inputPath.empty()) {
+                inputPath = argv[i];
+            } else if (outputPath.empty()) {
+                outputPath = argv[i];
+            } else {
+                usage();
+                return 2;
+            }
+        }
+    } catch (const std::invalid_argument& error) {
+        std::cerr << "Ошибка: " << error.what() << std::endl;
+        usage();
+        return 2;
+    }
+    if (inputPath.empty()) {
+        usage();
+        return 2;
+    }
+
+    try {
+        MappedFile file(inputPath);
+        std::FILE* out = outputPath.empty() ? stdout : std::fopen(outputPath.c_str(), "w");
+        if (out == nullptr) {
+            throw std::runtime_error("Cannot open " + outputPath + ": " + std::strerror(errno));
+        }
+        std::setvbuf(out, outputBuffer, _IOFBF, sizeof(outputBuffer));
+
+        // Вызывающий поток тоже работает, поэтому в пуле на один меньше;
+        // при -j 1 пул пуст и строки вычисляются последовательно
+        ThreadPool pool(threads - 1);
+        const std::size_t shardsPerWindow = (pool.size() + 1) * 4;
+        const std::string_view text = file.view();
+        const auto started = std::chrono::steady_clock::now();
+        std::size_t lines = 0;
+
+        std::size_t windowBegin = 0;
+        while (windowBegin < text.size()) {
+            // Атомы окна не нужны после записи его результатов
+            AtomTable::Epoch epoch;
+            const std::size_t windowEnd = lineBoundary(text, windowBegin + WINDOW_BYTES, text.size());
+            const std::size_t step = (windowEnd - windowBegin + shardsPerWindow - 1) / shardsPerWindow;
+            std::vector<Shard> shards;
+            for (std::size_t begin = windowBegin; begin < windowEnd;) {
+                const std::size_t end = lineBoundary(text, begin + step, windowEnd);
+                shards.push_back(Shard{begin, end, 0, std::string()});
+                begin = end;
+            }
+            pool.parallelFor(shards.size(), [&](std::size_t begin, std::size_t end) {
+                for (std::size_t s = begin; s < end; ++s) {
+                    evaluateShard(text, shards[s]);
+                }
+            });
+            for (const auto& shard : shards) {
+                std::fwrite(shard.output.data(), 1, shard.output.size(), out);
+                lines += shard.lines;
+            }
+            file.release(windowEnd);
+            windowBegin = windowEnd;
+        }
+
+        std::fflush(out);
+        if (out != stdout) std::fclose(out);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        struct rusage usage;
+        ::getrusage(RUSAGE_SELF, &usage);
+        std::cerr << "Строк: " << lines
+                  << ", время: " << seconds << " с"
+                  << ", строк в секунду: " << static_cast<std::size_t>(seconds > 0 ? lines / seconds : 0)
+                  << ", пиковая память: " << usage.ru_maxrss / 1024 << " МБ" << std::endl;
+    } catch (const std::exception& error) {
+        std::cerr << "Ошибка: " << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
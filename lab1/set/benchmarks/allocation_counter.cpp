@@ -0,0 +1,109 @@
+#include "allocation_counter.h"
+#include "SetStats.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef SET_ENABLE_STATS
+// В сборке со статистикой operator new уже заменён в SetStats.cpp
+std::size_t AllocationCounter::allocations() {
+    return static_cast<std::size_t>(SetStats::heapAllocations());
+}
+
+std::size_t AllocationCounter::bytes() {
+    return static_cast<std::size_t>(SetStats::heapBytes());
+}
+
+void AllocationCounter::reset() {
+    SetStats::resetHeap();
+}
+#else
+namespace {
+
+std::atomic<std::size_t> allocationCount{0};
+std::atomic<std::size_t> allocatedBytes{0};
+
+void* countedAllocate(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+// std::pmr::new_delete_resource выделяет память выровненной формой new
+void* countedAllocateAligned(std::size_t size, std::align_val_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    const std::size_t rounded = (size + align - 1) / align * align;
+    if (void* memory = std::aligned_alloc(align, rounded == 0 ? align : rounded)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+}
+
+std::size_t AllocationCounter::allocations() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+std::size_t AllocationCounter::bytes() {
+    return allocatedBytes.load(std::memory_order_relaxed);
+}
+
+void AllocationCounter::reset() {
+    allocationCount.store(0, std::memory_order_relaxed);
+    allocatedBytes.store(0, std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size) {
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return countedAllocate(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return countedAllocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return countedAllocateAligned(size, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+#endif
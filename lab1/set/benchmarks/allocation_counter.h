@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+// Счётчики глобальных operator new, подключаемые к бенчмаркам
+// заменой operator new/delete в allocation_counter.cpp (в сборке с
+// SET_ENABLE_STATS — в SetStats.cpp).
+struct AllocationCounter {
+    static std::size_t allocations();
+    static std::size_t bytes();
+    static void reset();
+};
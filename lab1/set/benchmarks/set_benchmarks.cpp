@@ -0,0 +1,696 @@
+#include <benchmark/benchmark.h>
+#include "Set.h"
+#include "AtomBitSet.h"
+#include "BloomFilter.h"
+#include "PersistentSet.h"
+#include "SetCollection.h"
+#include "SetExpression.h"
+#include "SetFile.h"
+#include "SetProduct.h"
+#include "StructuralScanner.h"
+#include "SubsetStore.h"
+#include "ThreadPool.h"
+#include "allocation_counter.h"
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+// Один элемент верхнего уровня, внутри которого много вложенных групп:
+// устранение дубликатов на верхнем уровне не участвует, измеряется разбор.
+static std::string makeNestedInput(std::size_t groups) {
+    std::string input = "{{";
+    for (std::size_t g = 0; g < groups; ++g) {
+        if (g > 0) input += ", ";
+        input += "{";
+        for (std::size_t i = 0; i < 8; ++i) {
+            if (i > 0) input += ", ";
+            input += "atom_" + std::to_string(g) + "_" + std::to_string(i);
+        }
+        input += "}";
+    }
+    input += "}}";
+    return input;
+}
+
+static void BM_DeserializeNested(benchmark::State& state) {
+    const std::string input = makeNestedInput(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        Set set = Set::deserialize(input);
+        benchmark::DoNotOptimize(set);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+BENCHMARK(BM_DeserializeNested)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 16)->Unit(benchmark::kMillisecond);
+
+// Построение текста: кеш сбрасывается вставкой и удалением метки
+static void BM_SerializeNested(benchmark::State& state) {
+    const std::string input = makeNestedInput(static_cast<std::size_t>(state.range(0)));
+    Set set = Set::deserialize(input);
+    const Set::Element marker("marker");
+    for (auto _ : state) {
+        state.PauseTiming();
+        set.insert(marker);
+        set.erase(marker);
+        state.ResumeTiming();
+        std::string text = set.serialize();
+        benchmark::DoNotOptimize(text);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+BENCHMARK(BM_SerializeNested)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 16)->Unit(benchmark::kMillisecond);
+
+// Повторный вывод неизменного множества берёт текст из кеша
+static void BM_SerializeCached(benchmark::State& state) {
+    const std::string input = makeNestedInput(static_cast<std::size_t>(state.range(0)));
+    const Set set = Set::deserialize(input);
+    for (auto _ : state) {
+        std::ostringstream out;
+        out << set;
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+BENCHMARK(BM_SerializeCached)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 16)->Unit(benchmark::kMicrosecond);
+
+// Множества как ключи: хеш вычисляется один раз на множество
+static void BM_HashKeyLookup(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    std::unordered_set<Set> keys;
+    std::vector<Set> probes;
+    for (std::size_t i = 0; i < n; ++i) {
+        Set key("{{k" + std::to_string(i) + ", a, b}, {c, d}}");
+        probes.push_back(key);
+        keys.insert(std::move(key));
+    }
+    for (auto _ : state) {
+        for (const Set& probe : probes) {
+            benchmark::DoNotOptimize(keys.count(probe));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+BENCHMARK(BM_HashKeyLookup)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_DeserializeBinaryNested(benchmark::State& state) {
+    const std::string binary =
+        Set::deserialize(makeNestedInput(static_cast<std::size_t>(state.range(0)))).serializeBinary();
+    for (auto _ : state) {
+        Set set = Set::deserializeBinary(binary);
+        benchmark::DoNotOptimize(set);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * binary.size()));
+}
+BENCHMARK(BM_DeserializeBinaryNested)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 16)->Unit(benchmark::kMillisecond);
+
+// Плоские множества из общего словаря: половина атомов совпадает
+static Set makeFlatSet(std::size_t count, std::size_t offset) {
+    std::vector<Set::Element> items;
+    for (std::size_t i = 0; i < count; ++i) {
+        items.emplace_back("w" + std::to_string(offset + i));
+    }
+    return Set(items);
+}
+
+static void BM_FlatIntersectSet(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    Set a = makeFlatSet(n, 0);
+    Set b = makeFlatSet(n, n / 2);
+    for (auto _ : state) {
+        Set result = a.intersect(b);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_FlatIntersectSet)->Arg(256)->Arg(2048);
+
+static void BM_FlatIntersectAtomBitSet(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    auto dictionary = std::make_shared<AtomDictionary>();
+    AtomBitSet a = AtomBitSet::fromSet(makeFlatSet(n, 0), dictionary);
+    AtomBitSet b = AtomBitSet::fromSet(makeFlatSet(n, n / 2), dictionary);
+    for (auto _ : state) {
+        AtomBitSet result = a.intersect(b);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_FlatIntersectAtomBitSet)->Arg(256)->Arg(2048);
+
+static void reportAllocations(benchmark::State& state, std::size_t allocations) {
+    state.counters["allocs/op"] = benchmark::Counter(
+        static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+// Цепочка над временными объектами: && перегрузки работают на месте
+static void BM_ChainedRvalue(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    Set a = makeFlatSet(n, 0), b = makeFlatSet(n, n / 4), c = makeFlatSet(n, n / 8), d = makeFlatSet(n / 4, 0);
+    AllocationCounter::reset();
+    for (auto _ : state) {
+        Set result = Set(a).unite(b).intersect(c).difference(d);
+        benchmark::DoNotOptimize(result);
+    }
+    reportAllocations(state, AllocationCounter::allocations());
+}
+BENCHMARK(BM_ChainedRvalue)->Arg(64)->Arg(512);
+
+// Та же цепочка через именованные промежуточные множества
+static void BM_ChainedCopies(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    Set a = makeFlatSet(n, 0), b = makeFlatSet(n, n / 4), c = makeFlatSet(n, n / 8), d = makeFlatSet(n / 4, 0);
+    AllocationCounter::reset();
+    for (auto _ : state) {
+        Set copy(a);
+        Set united = copy.unite(b);
+        Set common = united.intersect(c);
+        Set result = common.difference(d);
+        benchmark::DoNotOptimize(result);
+    }
+    reportAllocations(state, AllocationCounter::allocations());
+}
+BENCHMARK(BM_ChainedCopies)->Arg(64)->Arg(512);
+
+// A ∪ B ∩ C \ D: пошагово с промежуточными множествами и одним проходом
+static void BM_ExpressionEager(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    Set a = makeFlatSet(n, 0), b = makeFlatSet(n, n / 2), c = makeFlatSet(n, n / 4), d = makeFlatSet(n / 4, n / 4);
+    for (auto _ : state) {
+        Set result = a.unite(b).intersect(c).difference(d);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_ExpressionEager)->Arg(256)->Arg(2048);
+
+static void BM_ExpressionLazy(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    Set a = makeFlatSet(n, 0), b = makeFlatSet(n, n / 2), c = makeFlatSet(n, n / 4), d = makeFlatSet(n / 4, n / 4);
+    for (auto _ : state) {
+        Set result = ((lazy(a) | b) & c) - d;
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_ExpressionLazy)->Arg(256)->Arg(2048);
+
+// Сотня множеств: свёртка selfUnite/selfIntersect против uniteAll/intersectAll
+static std::vector<Set> makeFlatSets(std::size_t count, std::size_t size) {
+    std::vector<Set> sets;
+    for (std::size_t k = 0; k < count; ++k) {
+        sets.push_back(makeFlatSet(size, k * size / 8));
+    }
+    return sets;
+}
+
+static void BM_FoldUnite(benchmark::State& state) {
+    std::vector<Set> sets = makeFlatSets(100, static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        Set result;
+        for (const Set& set : sets) result.selfUnite(set);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_FoldUnite)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond);
+
+static void BM_UniteAll(benchmark::State& state) {
+    std::vector<Set> sets = makeFlatSets(100, static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        Set result = Set::uniteAll(sets);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_UniteAll)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond);
+
+static void BM_FoldIntersect(benchmark::State& state) {
+    std::vector<Set> sets = makeFlatSets(100, static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        Set result = sets.front();
+        for (const Set& set : sets) result.selfIntersect(set);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_FoldIntersect)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond);
+
+static void BM_IntersectAll(benchmark::State& state) {
+    std::vector<Set> sets = makeFlatSets(100, static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        Set result = Set::intersectAll(sets);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_IntersectAll)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond);
+
+// Разбор и уничтожение дерева: глобальная куча против арены,
+// которая освобождается целиком после итерации
+static void BM_DeserializeNestedHeap(benchmark::State& state) {
+    const std::string input = makeNestedInput(static_cast<std::size_t>(state.range(0)));
+    AllocationCounter::reset();
+    for (auto _ : state) {
+        Set set = Set::deserialize(input);
+        benchmark::DoNotOptimize(set);
+    }
+    reportAllocations(state, AllocationCounter::allocations());
+}
+BENCHMARK(BM_DeserializeNestedHeap)->Arg(1 << 10)->Arg(1 << 14)->Unit(benchmark::kMillisecond);
+
+static void BM_DeserializeNestedArena(benchmark::State& state) {
+    const std::string input = makeNestedInput(static_cast<std::size_t>(state.range(0)));
+    AllocationCounter::reset();
+    for (auto _ : state) {
+        std::pmr::monotonic_buffer_resource arena(input.size() * 2);
+        Set set = Set::deserialize(input, &arena);
+        benchmark::DoNotOptimize(set);
+    }
+    reportAllocations(state, AllocationCounter::allocations());
+}
+BENCHMARK(BM_DeserializeNestedArena)->Arg(1 << 10)->Arg(1 << 14)->Unit(benchmark::kMillisecond);
+
+static void BM_PowerSetHeap(benchmark::State& state) {
+    const Set set = makeFlatSet(static_cast<std::size_t>(state.range(0)), 0);
+    AllocationCounter::reset();
+    for (auto _ : state) {
+        Set power = set.powerSet();
+        benchmark::DoNotOptimize(power);
+    }
+    reportAllocations(state, AllocationCounter::allocations());
+}
+BENCHMARK(BM_PowerSetHeap)->Arg(8)->Arg(11)->Unit(benchmark::kMillisecond);
+
+static void BM_PowerSetArena(benchmark::State& state) {
+    std::pmr::monotonic_buffer_resource source;
+    const Set set(makeFlatSet(static_cast<std::size_t>(state.range(0)), 0), &source);
+    AllocationCounter::reset();
+    for (auto _ : state) {
+        std::pmr::monotonic_buffer_resource arena;
+        Set power = Set(set, &arena).powerSet();
+        benchmark::DoNotOptimize(power);
+    }
+    reportAllocations(state, AllocationCounter::allocations());
+}
+BENCHMARK(BM_PowerSetArena)->Arg(8)->Arg(11)->Unit(benchmark::kMillisecond);
+
+// Снимок неизменяемого множества против копии Set
+static void BM_SnapshotCopySet(benchmark::State& state) {
+    const Set set = makeFlatSet(static_cast<std::size_t>(state.range(0)), 0);
+    for (auto _ : state) {
+        Set copy(set);
+        benchmark::DoNotOptimize(copy);
+    }
+}
+BENCHMARK(BM_SnapshotCopySet)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_SnapshotPersistent(benchmark::State& state) {
+    const PersistentSet set(makeFlatSet(static_cast<std::size_t>(state.range(0)), 0));
+    for (auto _ : state) {
+        PersistentSet copy(set);
+        benchmark::DoNotOptimize(copy);
+    }
+}
+BENCHMARK(BM_SnapshotPersistent)->Arg(1 << 10)->Arg(1 << 14);
+
+static void BM_PersistentInsert(benchmark::State& state) {
+    const PersistentSet set(makeFlatSet(static_cast<std::size_t>(state.range(0)), 0));
+    const Set::Element extra("extra");
+    for (auto _ : state) {
+        PersistentSet next = set.insert(extra);
+        benchmark::DoNotOptimize(next);
+    }
+}
+BENCHMARK(BM_PersistentInsert)->Arg(1 << 10)->Arg(1 << 14);
+
+// Поиск надмножеств среди многих небольших множеств: перебор против индекса
+static std::vector<Set> makeCollectionSets(std::size_t count) {
+    std::vector<Set> sets;
+    sets.reserve(count);
+    for (std::size_t s = 0; s < count; ++s) {
+        Set set;
+        for (std::size_t i = 0; i < 16; ++i) {
+            set.insert(Set::Element("c" + std::to_string((s * 7 + i * 13) % 512)));
+        }
+        sets.push_back(std::move(set));
+    }
+    return sets;
+}
+
+static void BM_SupersetScan(benchmark::State& state) {
+    const std::vector<Set> sets = makeCollectionSets(static_cast<std::size_t>(state.range(0)));
+    const Set query = Set("{c0, c13}");
+    for (auto _ : state) {
+        std::size_t found = 0;
+        for (const auto& set : sets) {
+            bool all = true;
+            for (const auto& element : query) all = all && set.contains(element);
+            found += all;
+        }
+        benchmark::DoNotOptimize(found);
+    }
+}
+BENCHMARK(BM_SupersetScan)->Arg(1 << 12)->Arg(1 << 15)->Unit(benchmark::kMicrosecond);
+
+static void BM_SupersetIndex(benchmark::State& state) {
+    SetCollection collection;
+    for (const auto& set : makeCollectionSets(static_cast<std::size_t>(state.range(0)))) collection.add(set);
+    const Set query = Set("{c0, c13}");
+    for (auto _ : state) {
+        auto ids = collection.supersetsOf(query);
+        benchmark::DoNotOptimize(ids);
+    }
+}
+BENCHMARK(BM_SupersetIndex)->Arg(1 << 12)->Arg(1 << 15)->Unit(benchmark::kMicrosecond);
+
+// Массовое построение с половиной повторов
+static void BM_BulkConstruct(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    std::vector<Set::Element> items;
+    items.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        items.push_back(Set::Element("k" + std::to_string(i % (n / 2))));
+    }
+    for (auto _ : state) {
+        Set set(items.begin(), items.end());
+        benchmark::DoNotOptimize(set);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+BENCHMARK(BM_BulkConstruct)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+// Первый проход разбора: классификация символов разными ядрами
+static void BM_StructuralScan(benchmark::State& state) {
+    const std::string input = makeNestedInput(1 << 14);
+    const auto kernel = static_cast<StructuralScanner::Kernel>(state.range(0));
+    for (auto _ : state) {
+        StructuralIndex index = StructuralScanner::scan(input, kernel);
+        benchmark::DoNotOptimize(index);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+BENCHMARK(BM_StructuralScan)
+    ->Arg(static_cast<int>(StructuralScanner::Kernel::SCALAR))
+    ->Arg(static_cast<int>(StructuralScanner::Kernel::SSE2))
+    ->Arg(static_cast<int>(StructuralScanner::Kernel::AVX2));
+
+// Записи с повторяющимися вложенными частями, как в выгрузке прав доступа:
+// у каждого пользователя своё имя, а группы и наборы прав общие
+static std::string makeRecordsInput(std::size_t records) {
+    static const char* const RIGHTS[] = {"{read}", "{read, write}", "{read, write, delete}", "{admin}"};
+    std::string input = "{";
+    for (std::size_t r = 0; r < records; ++r) {
+        if (r > 0) input += ", ";
+        input += "{user_" + std::to_string(r) + ", {group_" + std::to_string(r % 16) + ", ";
+        input += RIGHTS[r % 4];
+        input += "}, {profile, {department_" + std::to_string(r % 8) + "}, ";
+        input += RIGHTS[(r / 4) % 4];
+        input += "}}";
+    }
+    input += "}";
+    return input;
+}
+
+// Время уплотнения и занимаемая память до и после
+static void BM_Compact(benchmark::State& state) {
+    const std::string input = makeRecordsInput(static_cast<std::size_t>(state.range(0)));
+    std::size_t before = 0;
+    std::size_t after = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        Set set(input);
+        before = set.memoryUsage();
+        state.ResumeTiming();
+        set.compact();
+        state.PauseTiming();
+        after = set.memoryUsage();
+        state.ResumeTiming();
+    }
+    state.counters["bytes_before"] = static_cast<double>(before);
+    state.counters["bytes_after"] = static_cast<double>(after);
+    state.counters["saved_%"] = 100.0 * static_cast<double>(before - after) / static_cast<double>(before);
+}
+BENCHMARK(BM_Compact)->Arg(1 << 10)->Arg(1 << 14)->Unit(benchmark::kMillisecond);
+
+// Сам подсчёт памяти обходит всё дерево
+static void BM_MemoryUsage(benchmark::State& state) {
+    const Set set(makeRecordsInput(static_cast<std::size_t>(state.range(0))));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(set.memoryUsage());
+    }
+}
+BENCHMARK(BM_MemoryUsage)->Arg(1 << 10)->Arg(1 << 14)->Unit(benchmark::kMicrosecond);
+
+// Промахи has на большом множестве: с фильтром Блума и без него
+static void BM_HasMiss(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const bool filtered = state.range(1) != 0;
+    std::vector<Set::Element> items;
+    for (std::size_t i = 0; i < n; ++i) {
+        items.emplace_back(std::vector<Set::Element>{Set::Element("k" + std::to_string(i)), Set::Element("v")});
+    }
+    Set set(std::move(items));
+    set.setFilterEnabled(filtered);
+    std::vector<Set::Element> probes;
+    for (std::size_t i = 0; i < 256; ++i) {
+        probes.emplace_back(std::vector<Set::Element>{Set::Element("miss" + std::to_string(i)), Set::Element("v")});
+    }
+    benchmark::DoNotOptimize(set.has(probes.front()));
+    for (auto _ : state) {
+        for (const auto& probe : probes) {
+            benchmark::DoNotOptimize(set.has(probe));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * probes.size()));
+    const Set::FilterStats stats = set.filterStats();
+    state.counters["filter_bytes"] = static_cast<double>(stats.bytes);
+    state.counters["fpr_estimate"] = stats.falsePositiveRate;
+    if (filtered) {
+        // Такой же фильтр снаружи показывает долю ложных срабатываний
+        BloomFilter check(set.size() * 2);
+        for (const auto& element : set) {
+            check.add(Set::ElementHash()(element));
+        }
+        std::size_t passed = 0;
+        for (std::size_t i = 0; i < 100000; ++i) {
+            passed += check.mayContain(Set::ElementHash()(Set::Element("probe" + std::to_string(i))));
+        }
+        state.counters["fpr_observed"] = static_cast<double>(passed) / 100000.0;
+    }
+}
+BENCHMARK(BM_HasMiss)->ArgNames({"n", "filter"})->ArgsProduct({{1 << 10, 1 << 14}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+// Симметрическая разность: через difference и unite с промежуточными
+// множествами и одним проходом
+static std::pair<Set, Set> makeShiftedSets(std::size_t n) {
+    std::vector<Set::Element> left;
+    std::vector<Set::Element> right;
+    for (std::size_t i = 0; i < n; ++i) {
+        left.emplace_back("k" + std::to_string(i));
+        right.emplace_back("k" + std::to_string(i + n / 2));
+    }
+    return {Set(std::move(left)), Set(std::move(right))};
+}
+
+static void BM_SymmetricDifferenceComposed(benchmark::State& state) {
+    const auto sets = makeShiftedSets(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        Set result = sets.first.difference(sets.second).unite(sets.second.difference(sets.first));
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_SymmetricDifferenceComposed)->Arg(1 << 8)->Arg(1 << 12)->Unit(benchmark::kMicrosecond);
+
+static void BM_SymmetricDifference(benchmark::State& state) {
+    const auto sets = makeShiftedSets(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        Set result = sets.first.symmetricDifference(sets.second);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_SymmetricDifference)->Arg(1 << 8)->Arg(1 << 12)->Unit(benchmark::kMicrosecond);
+
+// Потоковый обход произведения: пары строятся по одной
+static void BM_ProductStream(benchmark::State& state) {
+    const auto sets = makeShiftedSets(static_cast<std::size_t>(state.range(0)));
+    const SetProduct product = sets.first.product(sets.second);
+    for (auto _ : state) {
+        std::size_t nested = 0;
+        product.forEach([&nested](const Set::Element& pair) { nested += pair.subset.size(); });
+        benchmark::DoNotOptimize(nested);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * product.size()));
+}
+BENCHMARK(BM_ProductStream)->Arg(1 << 8)->Arg(1 << 10)->Unit(benchmark::kMillisecond);
+
+// Масштабирование параллельных операций: от одного потока до числа ядер.
+// Аргументы: op (0 — unite, 1 — intersect, 2 — difference) и threads.
+static void parallelAlgebraArgs(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"op", "threads"});
+    const std::int64_t cores = std::max<std::int64_t>(1, std::thread::hardware_concurrency());
+    for (std::int64_t op = 0; op < 3; ++op) {
+        for (std::int64_t threads = 1; threads < cores; threads *= 2) {
+            benchmark->Args({op, threads});
+        }
+        benchmark->Args({op, cores});
+    }
+}
+
+static void BM_ParallelAlgebra(benchmark::State& state) {
+    const std::size_t n = 1 << 21;
+    static const auto sets = makeShiftedSets(n);
+    // Вызывающий поток работает наравне с пулом; при threads == 1 пул
+    // пуст и операции выполняются последовательно
+    const std::size_t threads = static_cast<std::size_t>(state.range(1));
+    ThreadPool pool(threads - 1);
+    for (auto _ : state) {
+        Set result;
+        switch (state.range(0)) {
+            case 0: result = sets.first.parallelUnite(sets.second, pool); break;
+            case 1: result = sets.first.parallelIntersect(sets.second, pool); break;
+            default: result = sets.first.parallelDifference(sets.second, pool); break;
+        }
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * 2 * n));
+}
+BENCHMARK(BM_ParallelAlgebra)->Apply(parallelAlgebraArgs)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Проверка подмножества: предикат с выходом на первом свидетеле против
+// построения разности. Аргументы: size и subset (1 — множество вложено).
+static void BM_IsSubset(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const auto sets = makeShiftedSets(n);
+    const Set outer = sets.first.unite(sets.second);
+    const Set& probe = state.range(1) != 0 ? sets.first : sets.second;
+    const Set& host = state.range(1) != 0 ? outer : sets.first;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(probe.isSubsetOf(host));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+BENCHMARK(BM_IsSubset)->ArgNames({"size", "subset"})->ArgsProduct({{1 << 10, 1 << 16}, {0, 1}});
+
+static void BM_IsSubsetByDifference(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const auto sets = makeShiftedSets(n);
+    const Set outer = sets.first.unite(sets.second);
+    const Set& probe = state.range(1) != 0 ? sets.first : sets.second;
+    const Set& host = state.range(1) != 0 ? outer : sets.first;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(probe.difference(host).isEmpty());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+BENCHMARK(BM_IsSubsetByDifference)->ArgNames({"size", "subset"})->ArgsProduct({{1 << 10, 1 << 16}, {0, 1}});
+
+// Равенство вложенных элементов с переставленными детьми: сравнение
+// отпечатков, закешированных в узлах, без временных множеств
+static void BM_NestedEquality(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    std::vector<Set::Element> forward;
+    std::vector<Set::Element> backward;
+    for (std::size_t i = 0; i < n; ++i) {
+        forward.emplace_back("e" + std::to_string(i));
+        backward.emplace_back("e" + std::to_string(n - 1 - i));
+    }
+    const Set::Element left(std::move(forward));
+    const Set::Element right(std::move(backward));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(left == right);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+BENCHMARK(BM_NestedEquality)->Arg(1 << 6)->Arg(1 << 12);
+
+// Хеш-консинг записей с повторяющимися вложенными группами: время
+// канонизации и память до и после, затем равенство элементов
+static void BM_InternNested(benchmark::State& state) {
+    const std::string input = makeRecordsInput(static_cast<std::size_t>(state.range(0)));
+    std::size_t before = 0;
+    std::size_t after = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        Set set(input);
+        before = set.memoryUsage();
+        state.ResumeTiming();
+        SubsetStore store;
+        set.internNested(store);
+        state.PauseTiming();
+        after = set.memoryUsage();
+        state.ResumeTiming();
+    }
+    state.counters["bytes_before"] = static_cast<double>(before);
+    state.counters["bytes_after"] = static_cast<double>(after);
+    state.counters["saved_%"] = 100.0 * static_cast<double>(before - after) / static_cast<double>(before);
+}
+BENCHMARK(BM_InternNested)->Arg(1 << 8)->Arg(1 << 12)->Unit(benchmark::kMillisecond);
+
+static void BM_InternedEquality(benchmark::State& state) {
+    SubsetStore store;
+    std::vector<Set::Element> left;
+    std::vector<Set::Element> right;
+    for (std::size_t i = 0; i < 256; ++i) {
+        left.emplace_back(std::vector<Set::Element>{Set::Element("g" + std::to_string(i)), Set::Element("x")});
+        right.emplace_back(std::vector<Set::Element>{Set::Element("x"), Set::Element("g" + std::to_string(i))});
+    }
+    if (state.range(0) != 0) {
+        for (auto& element : left) element = store.intern(element);
+        for (auto& element : right) element = store.intern(element);
+    }
+    for (auto _ : state) {
+        std::size_t equal = 0;
+        for (std::size_t i = 0; i < left.size(); ++i) {
+            equal += left[i] == right[i];
+            equal += left[i] == right[(i + 1) % right.size()];
+        }
+        benchmark::DoNotOptimize(equal);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * 2 * left.size()));
+}
+BENCHMARK(BM_InternedEquality)->ArgName("interned")->Arg(0)->Arg(1);
+
+// Точечные запросы к файлу множества: индексированный SetFile против
+// чтения двоичного формата целиком. Аргумент — число элементов.
+static const std::string& writeBenchmarkFiles(std::size_t n) {
+    static std::size_t written = 0;
+    static const std::string path = "/tmp/set_benchmark_file";
+    if (written != n) {
+        const Set set = makeFlatSet(n, 0);
+        SetFile::write(set, path + ".setf");
+        const std::string binary = set.serializeBinary();
+        std::ofstream(path + ".setb", std::ios::binary).write(binary.data(), static_cast<std::streamsize>(binary.size()));
+        written = n;
+    }
+    return path;
+}
+
+static void BM_SetFileContains(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const SetFile file(writeBenchmarkFiles(n) + ".setf");
+    const Set probes = makeFlatSet(64, n - 32);
+    for (auto _ : state) {
+        std::size_t found = 0;
+        for (const auto& probe : probes) {
+            found += file.contains(probe);
+        }
+        benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * probes.size()));
+}
+BENCHMARK(BM_SetFileContains)->Arg(1 << 14)->Arg(1 << 18)->Unit(benchmark::kMicrosecond);
+
+static void BM_BinaryFileContains(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const std::string path = writeBenchmarkFiles(n) + ".setb";
+    const Set probes = makeFlatSet(64, n - 32);
+    for (auto _ : state) {
+        const Set set = Set::loadBinaryFile(path);
+        std::size_t found = 0;
+        for (const auto& probe : probes) {
+            found += set.contains(probe);
+        }
+        benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * probes.size()));
+}
+BENCHMARK(BM_BinaryFileContains)->Arg(1 << 14)->Arg(1 << 18)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
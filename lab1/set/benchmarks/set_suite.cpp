@@ -0,0 +1,172 @@
+#include <benchmark/benchmark.h>
+#include "Set.h"
+#include "allocation_counter.h"
+#include "workloads.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Набор бенчмарков основных операций Set на сгенерированных нагрузках.
+// Аргументы: n — число элементов верхнего уровня, shape — вид нагрузки.
+// Кроме времени на операцию выводятся allocs/op и bytes/element
+// (байты, выделенные за операцию, на элемент входа).
+namespace {
+
+const Shape SHAPES[] = {Shape::FLAT, Shape::WIDE, Shape::DEEP, Shape::MIXED};
+
+// Все операции, кроме powerSet, линейны и проходят весь диапазон; для
+// вложенных нагрузок он короче из-за объёма памяти генератора
+void linearSizes(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"n", "shape"});
+    for (Shape shape : SHAPES) {
+        const std::int64_t limit = shape == Shape::FLAT ? 1000000 : 100000;
+        for (std::int64_t n = 10; n <= limit; n *= 10) {
+            benchmark->Args({n, static_cast<std::int64_t>(shape)});
+        }
+    }
+}
+
+struct Scope {
+    explicit Scope(benchmark::State& state)
+        : n(static_cast<std::size_t>(state.range(0))), shape(static_cast<Shape>(state.range(1))) {
+        state.SetLabel(shapeName(shape));
+    }
+
+    std::size_t n;
+    Shape shape;
+};
+
+// Счётчики снимаются только внутри цикла измерения
+void report(benchmark::State& state, std::size_t n) {
+    state.counters["allocs/op"] = benchmark::Counter(
+        static_cast<double>(AllocationCounter::allocations()), benchmark::Counter::kAvgIterations);
+    state.counters["bytes/element"] = benchmark::Counter(
+        static_cast<double>(AllocationCounter::bytes()) / static_cast<double>(n),
+        benchmark::Counter::kAvgIterations);
+}
+
+void BM_Contains(benchmark::State& state) {
+    Scope scope(state);
+    WorkloadGenerator generator;
+    const Set set = generator.make(scope.shape, scope.n);
+    const Set::Element present = *(set.begin() + static_cast<std::ptrdiff_t>(scope.n / 2));
+    AllocationCounter::reset();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(set.contains(present));
+    }
+    report(state, scope.n);
+}
+BENCHMARK(BM_Contains)->Apply(linearSizes);
+
+void BM_Unite(benchmark::State& state) {
+    Scope scope(state);
+    WorkloadGenerator generator;
+    const auto sets = generator.overlapping(scope.shape, scope.n);
+    AllocationCounter::reset();
+    for (auto _ : state) {
+        Set result = sets.first.unite(sets.second);
+        benchmark::DoNotOptimize(result);
+    }
+    report(state, scope.n);
+}
+BENCHMARK(BM_Unite)->Apply(linearSizes);
+
+void BM_Intersect(benchmark::State& state) {
+    Scope scope(state);
+    WorkloadGenerator generator;
+    const auto sets = generator.overlapping(scope.shape, scope.n);
+    AllocationCounter::reset();
+    for (auto _ : state) {
+        Set result = sets.first.intersect(sets.second);
+        benchmark::DoNotOptimize(result);
+    }
+    report(state, scope.n);
+}
+BENCHMARK(BM_Intersect)->Apply(linearSizes);
+
+void BM_Difference(benchmark::State& state) {
+    Scope scope(state);
+    WorkloadGenerator generator;
+    const auto sets = generator.overlapping(scope.shape, scope.n);
+    AllocationCounter::reset();
+    for (auto _ : state) {
+        Set result = sets.first.difference(sets.second);
+        benchmark::DoNotOptimize(result);
+    }
+    report(state, scope.n);
+}
+BENCHMARK(BM_Difference)->Apply(linearSizes);
+
+void BM_Equal(benchmark::State& state) {
+    Scope scope(state);
+    WorkloadGenerator generator;
+    const Set set = generator.make(scope.shape, scope.n);
+    // Копия в обратном порядке: равенство не может сравнивать поэлементно
+    std::vector<Set::Element> reversed(set.begin(), set.end());
+    std::reverse(reversed.begin(), reversed.end());
+    const Set copy(std::move(reversed));
+    AllocationCounter::reset();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(set == copy);
+    }
+    report(state, scope.n);
+}
+BENCHMARK(BM_Equal)->Apply(linearSizes);
+
+void BM_PowerSet(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    WorkloadGenerator generator;
+    const Set set = generator.make(Shape::FLAT, n);
+    AllocationCounter::reset();
+    for (auto _ : state) {
+        Set power = set.powerSet();
+        benchmark::DoNotOptimize(power);
+    }
+    report(state, n);
+}
+BENCHMARK(BM_PowerSet)->ArgName("n")->DenseRange(4, 10, 2);
+
+void BM_Serialize(benchmark::State& state) {
+    Scope scope(state);
+    WorkloadGenerator generator;
+    Set set = generator.make(scope.shape, scope.n);
+    // Без сброса кеша измерялось бы только копирование готового текста.
+    // Первая вставка метки расширяет хранилище заранее. Фильтр Блума
+    // отключён: вставки и удаления метки сбрасывали бы его и строили
+    // заново, и эти выделения попадали бы в allocs/op. Тогда сброс кеша
+    // в цикле ничего не выделяет.
+    set.setFilterEnabled(false);
+    const Set::Element marker("marker");
+    set.insert(marker);
+    set.erase(marker);
+    std::size_t bytes = 0;
+    AllocationCounter::reset();
+    for (auto _ : state) {
+        state.PauseTiming();
+        set.insert(marker);
+        set.erase(marker);
+        state.ResumeTiming();
+        std::string text = set.serialize();
+        bytes += text.size();
+        benchmark::DoNotOptimize(text);
+    }
+    report(state, scope.n);
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+BENCHMARK(BM_Serialize)->Apply(linearSizes);
+
+void BM_Deserialize(benchmark::State& state) {
+    Scope scope(state);
+    WorkloadGenerator generator;
+    const std::string text = generator.make(scope.shape, scope.n).serialize();
+    AllocationCounter::reset();
+    for (auto _ : state) {
+        Set set = Set::deserialize(text);
+        benchmark::DoNotOptimize(set);
+    }
+    report(state, scope.n);
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * text.size()));
+}
+BENCHMARK(BM_Deserialize)->Apply(linearSizes);
+
+}
@@ -0,0 +1,74 @@
+#include "workloads.h"
+#include <string>
+
+const char* shapeName(Shape shape) {
+    switch (shape) {
+        case Shape::FLAT: return "flat";
+        case Shape::WIDE: return "wide";
+        case Shape::DEEP: return "deep";
+        case Shape::MIXED: return "mixed";
+    }
+    return "unknown";
+}
+
+WorkloadGenerator::WorkloadGenerator(std::uint64_t seed) : state_(seed), serial_(0) {}
+
+// splitmix64: быстрый генератор с хорошим перемешиванием
+std::uint64_t WorkloadGenerator::next() {
+    std::uint64_t value = (state_ += 0x9E3779B97F4A7C15ULL);
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+std::size_t WorkloadGenerator::below(std::size_t bound) {
+    return static_cast<std::size_t>(next() % bound);
+}
+
+Set::Element WorkloadGenerator::element(Shape shape) {
+    if (shape == Shape::MIXED) {
+        shape = static_cast<Shape>(below(3));
+    }
+    // Порядковый номер делает каждый элемент уникальным
+    Set::Element unique("u" + std::to_string(serial_++));
+    switch (shape) {
+        case Shape::WIDE: {
+            std::vector<Set::Element> items{unique};
+            const std::size_t width = 8 + below(9);
+            while (items.size() < width) {
+                items.emplace_back("w" + std::to_string(below(1024)));
+            }
+            return Set::Element(std::move(items));
+        }
+        case Shape::DEEP: {
+            Set::Element current = unique;
+            const std::size_t depth = 8 + below(25);
+            for (std::size_t level = 0; level < depth; ++level) {
+                current = Set::Element(std::vector<Set::Element>{current});
+            }
+            return current;
+        }
+        default:
+            return unique;
+    }
+}
+
+std::vector<Set::Element> WorkloadGenerator::elements(Shape shape, std::size_t count) {
+    std::vector<Set::Element> items;
+    items.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        items.push_back(element(shape));
+    }
+    return items;
+}
+
+Set WorkloadGenerator::make(Shape shape, std::size_t count) {
+    return Set(elements(shape, count));
+}
+
+std::pair<Set, Set> WorkloadGenerator::overlapping(Shape shape, std::size_t count) {
+    std::vector<Set::Element> items = elements(shape, count + count / 2);
+    Set first(items.begin(), items.begin() + static_cast<std::ptrdiff_t>(count));
+    Set second(items.begin() + static_cast<std::ptrdiff_t>(count / 2), items.end());
+    return {std::move(first), std::move(second)};
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Set.h"
+
+// Воспроизводимые нагрузки для бенчмарков: одно и то же зерно даёт одно и
+// то же множество. Элементы верхнего уровня всегда различны.
+enum class Shape {
+    FLAT,   // только атомы
+    WIDE,   // вложенные множества из 8–16 атомов
+    DEEP,   // цепочки вложенности глубиной 8–32 с атомом на дне
+    MIXED   // все три вида вперемешку
+};
+
+const char* shapeName(Shape shape);
+
+class WorkloadGenerator {
+public:
+    explicit WorkloadGenerator(std::uint64_t seed = 42);
+
+    std::vector<Set::Element> elements(Shape shape, std::size_t count);
+    Set make(Shape shape, std::size_t count);
+    // Два множества по count элементов, общая половина
+    std::pair<Set, Set> overlapping(Shape shape, std::size_t count);
+
+private:
+    std::uint64_t state_;
+    std::size_t serial_;
+
+    std::uint64_t next();
+    std::size_t below(std::size_t bound);
+    Set::Element element(Shape shape);
+};
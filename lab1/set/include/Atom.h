@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Глобальная таблица интернированных атомов. Каждой строке соответствует
+// 32-битный номер; строки хранятся в сегментах растущего размера и не
+// перемещаются. Поиск по строке и чтение по номеру выполняются без
+// блокировок, мьютекс берётся только при добавлении нового атома.
+// Атомы живут до конца программы, если их не создали внутри Epoch.
+class AtomTable {
+public:
+    static AtomTable& instance();
+
+    std::uint32_t intern(std::string_view value);
+    const std::string& lookup(std::uint32_t id) const;
+    std::size_t size() const;
+
+    // Область, атомы которой освобождаются при её закрытии: строки,
+    // номера и записи индекса атомов, появившихся после открытия,
+    // удаляются, и номера выдаются заново. Для потоковой обработки
+    // (set_batch, обход SetFile): без областей таблица растёт с каждым
+    // новым атомом. При закрытии ни один Atom из области не должен
+    // оставаться в живых, а другие потоки не должны обращаться к
+    // таблице; вложенные области закрываются в обратном порядке.
+    class Epoch {
+    public:
+        Epoch();
+        Epoch(const Epoch&) = delete;
+        Epoch& operator=(const Epoch&) = delete;
+        ~Epoch();
+
+    private:
+        std::uint32_t mark_;
+    };
+
+private:
+    static constexpr std::uint32_t FIRST_SEGMENT = 1024;
+    static constexpr std::size_t SEGMENTS = 22;
+    static constexpr std::uint32_t NOT_FOUND = UINT32_MAX;
+
+    // Открытая адресация: слот хранит (хеш << 32) | (номер + 1), 0 — пусто.
+    // При росте публикуется новая копия, старые остаются доступны читателям.
+    struct Index {
+        std::size_t mask;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> slots;
+
+        explicit Index(std::size_t capacity);
+    };
+
+    std::atomic<std::string*> segments_[SEGMENTS];
+    std::atomic<std::uint32_t> size_;
+    std::atomic<Index*> index_;
+    std::vector<std::unique_ptr<Index>> indexes_;
+    std::mutex mutex_;
+
+    AtomTable();
+    std::uint32_t find(const Index& index, std::string_view value, std::uint32_t hash) const;
+    static void place(Index& index, std::uint32_t hash, std::uint32_t id);
+    static void erase(Index& index, std::uint32_t hash, std::uint32_t id);
+    void truncate(std::uint32_t mark);
+    static std::uint32_t hashOf(std::string_view value);
+    static void locate(std::uint32_t id, std::size_t& segment, std::size_t& offset);
+};
+
+// Интернированный атом: 4 байта, сравнение на равенство — сравнение номеров.
+class Atom {
+public:
+    Atom();
+    Atom(const char* value);
+    Atom(const std::string& value);
+    explicit Atom(std::string_view value);
+
+    const std::string& str() const;
+    operator const std::string&() const;
+    std::uint32_t id() const;
+    std::size_t size() const;
+    bool empty() const;
+
+    friend bool operator==(const Atom& lhs, const Atom& rhs);
+    friend bool operator!=(const Atom& lhs, const Atom& rhs);
+    friend bool operator==(const Atom& lhs, const std::string& rhs);
+    friend bool operator!=(const Atom& lhs, const std::string& rhs);
+    friend bool operator==(const std::string& lhs, const Atom& rhs);
+    friend bool operator!=(const std::string& lhs, const Atom& rhs);
+    friend bool operator==(const Atom& lhs, const char* rhs);
+    friend bool operator!=(const Atom& lhs, const char* rhs);
+    friend bool operator==(const char* lhs, const Atom& rhs);
+    friend bool operator!=(const char* lhs, const Atom& rhs);
+    friend std::ostream& operator<<(std::ostream& os, const Atom& atom);
+
+private:
+    std::uint32_t id_;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Set.h"
+
+// Общий словарь атомов: каждому атому назначается плотный номер,
+// который служит индексом бита в AtomBitSet.
+class AtomDictionary {
+public:
+    static constexpr std::uint32_t NOT_FOUND = UINT32_MAX;
+
+    std::uint32_t intern(const std::string& atom);
+    std::uint32_t find(const std::string& atom) const;
+    const std::string& atom(std::uint32_t id) const;
+    std::size_t size() const;
+
+private:
+    std::unordered_map<std::string, std::uint32_t> ids_;
+    std::vector<const std::string*> atoms_;
+};
+
+// Плоское множество атомов из общего словаря в виде плотной битовой карты.
+// Операции выполняются по 64-битным словам; циклы без ветвлений
+// компилятор векторизует (SSE2/AVX2 при соответствующих флагах).
+class AtomBitSet {
+public:
+    explicit AtomBitSet(std::shared_ptr<AtomDictionary> dictionary);
+
+    // Преобразования; вложенные множества не поддерживаются
+    static AtomBitSet fromSet(const Set& set, std::shared_ptr<AtomDictionary> dictionary);
+    Set toSet() const;
+    std::vector<Set::Element> elements() const;
+
+    // Основные методы
+    bool contains(const Set::Element& item) const;
+    bool contains(const std::string& atom) const;
+    bool isEmpty() const;
+    std::size_t size() const;
+    void insert(const Set::Element& item);
+    void insert(const std::string& atom);
+    void erase(const Set::Element& item);
+    void erase(const std::string& atom);
+
+    // Операции над множествами
+    AtomBitSet unite(const AtomBitSet& other) const;
+    AtomBitSet& selfUnite(const AtomBitSet& other);
+    AtomBitSet intersect(const AtomBitSet& other) const;
+    AtomBitSet& selfIntersect(const AtomBitSet& other);
+    AtomBitSet difference(const AtomBitSet& other) const;
+    AtomBitSet& selfDifference(const AtomBitSet& other);
+
+    // Сравнение
+    bool operator==(const AtomBitSet& other) const;
+    bool operator!=(const AtomBitSet& other) const;
+
+    const std::shared_ptr<AtomDictionary>& dictionary() const;
+
+private:
+    std::shared_ptr<AtomDictionary> dictionary_;
+    std::vector<std::uint64_t> words_;
+
+    void checkDictionary(const AtomBitSet& other) const;
+    bool testBit(std::uint32_t id) const;
+    static const std::string& requireAtom(const Set::Element& item);
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Set.h"
+
+// Примитивы двоичного формата Set: varint (LEB128), фиксированные
+// 64-битные числа (little-endian) и контрольная сумма FNV-1a.
+class BinaryWriter {
+public:
+    void writeByte(std::uint8_t value);
+    void writeVarint(std::uint64_t value);
+    void writeFixed64(std::uint64_t value);
+    void writeBytes(std::string_view bytes);
+
+    const std::string& buffer() const;
+    std::string take();
+
+private:
+    std::string buffer_;
+};
+
+// Читает из внешнего буфера (например, отображённого файла) без копирования.
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view data);
+
+    std::uint8_t readByte();
+    std::uint64_t readVarint();
+    std::uint64_t readFixed64();
+    std::string_view readBytes(std::size_t count);
+
+    std::size_t position() const;
+    std::size_t remaining() const;
+    bool atEnd() const;
+
+private:
+    std::string_view data_;
+    std::size_t pos_;
+};
+
+// Кодирование дерева элементов: атомы заменяются индексами в таблице
+// уникальных строк, каждый элемент начинается с тега
+// (индекс атома << 1) или (число детей << 1 | 1).
+class ElementEncoder {
+public:
+    void collect(const Set::Element& element);
+    void writeAtomTable(BinaryWriter& out) const;
+    void writeElement(BinaryWriter& out, const Set::Element& element) const;
+
+private:
+    std::unordered_map<std::uint32_t, std::uint64_t> atomIndex_;
+    std::vector<Atom> atoms_;
+};
+
+class ElementDecoder {
+public:
+    void readAtomTable(BinaryReader& in);
+    Set::Element readElement(BinaryReader& in) const;
+
+private:
+    std::vector<Atom> atoms_;
+};
+
+std::uint64_t fnv1a64(std::string_view data);
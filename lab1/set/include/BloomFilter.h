@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Фильтр Блума по 64-битным хешам элементов. Отрицательный ответ точен,
+// положительный ошибочен с вероятностью falsePositiveRate(). Размер
+// подбирается по ожидаемому числу записей: BITS_PER_ENTRY бит на запись
+// с округлением до степени двойки и HASHES проб (около 1% ложных
+// срабатываний при заполнении до capacity).
+class BloomFilter {
+public:
+    static constexpr std::size_t BITS_PER_ENTRY = 10;
+    static constexpr unsigned HASHES = 7;
+
+    explicit BloomFilter(std::size_t capacity);
+
+    void add(std::uint64_t hash);
+    bool mayContain(std::uint64_t hash) const;
+    // Удалить запись из фильтра нельзя, учитывается только их число
+    void noteRemoved(std::size_t count);
+
+    std::size_t capacity() const;
+    std::size_t entries() const;
+    std::size_t removed() const;
+    std::size_t bits() const;
+    std::size_t memoryUsage() const;
+    // Оценка (1 - e^(-k·n/m))^k по числу добавленных записей
+    double falsePositiveRate() const;
+
+private:
+    std::vector<std::uint64_t> words_;
+    std::size_t mask_;
+    std::size_t capacity_;
+    std::size_t entries_;
+    std::size_t removed_;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_set>
+#include "Set.h"
+
+// Хеш-индекс элементов для проверки принадлежности за O(1) в среднем.
+// Хранит указатели: элементы должны жить дольше индекса.
+class ElementIndex {
+public:
+    ElementIndex();
+    explicit ElementIndex(const Set& set);
+
+    bool insert(const Set::Element& element);
+    bool contains(const Set::Element& element) const;
+    std::size_t size() const;
+    void reserve(std::size_t count);
+
+private:
+    struct PointerHash {
+        std::size_t operator()(const Set::Element* element) const;
+    };
+    struct PointerEqual {
+        bool operator()(const Set::Element* lhs, const Set::Element* rhs) const;
+    };
+
+    std::unordered_set<const Set::Element*, PointerHash, PointerEqual> elements_;
+};
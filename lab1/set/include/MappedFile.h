@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Файл, отображённый в память только для чтения (mmap).
+// Пустой файл не отображается, view() для него возвращает пустой срез.
+class MappedFile {
+public:
+    // Подсказка ядру о порядке чтения: упреждающее чтение при
+    // последовательном разборе, без него — при точечных обращениях
+    enum Access {
+        SEQUENTIAL,
+        RANDOM
+    };
+
+    explicit MappedFile(const std::string& path, Access access = SEQUENTIAL);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    std::string_view view() const;
+    std::size_t size() const;
+
+    // Подсказка ядру, что префикс [0, offset) больше не нужен:
+    // страницы освобождаются, и потребление памяти остаётся ограниченным.
+    void release(std::size_t offset);
+
+private:
+    const char* data_;
+    std::size_t size_;
+    std::size_t released_;
+
+    void unmap();
+};
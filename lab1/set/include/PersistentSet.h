@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "Set.h"
+
+// Неизменяемое множество на хеш-префиксном дереве (HAMT): 32-way узлы с
+// битовой маской, ключ — структурный хеш элемента (Set::ElementHash).
+// Копия — это копия указателя на корень, insert и erase возвращают новую
+// версию за O(log n), копируя только путь от корня; старые версии не
+// меняются, поэтому читать их можно из любых потоков без блокировок.
+class PersistentSet {
+public:
+    PersistentSet();
+    explicit PersistentSet(const Set& set);
+
+    // Основные методы
+    bool contains(const Set::Element& item) const;
+    bool isEmpty() const;
+    std::size_t size() const;
+
+    // Изменения не трогают текущую версию и возвращают новую
+    PersistentSet insert(const Set::Element& item) const;
+    PersistentSet erase(const Set::Element& item) const;
+
+    // Обход в порядке хешей
+    void forEach(const std::function<void(const Set::Element&)>& visitor) const;
+    Set toSet() const;
+
+    bool operator==(const PersistentSet& other) const;
+    bool operator!=(const PersistentSet& other) const;
+
+    // Версии, у которых общий корень, заведомо равны
+    bool sharesRootWith(const PersistentSet& other) const;
+
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    NodePtr root_;
+
+    explicit PersistentSet(NodePtr root);
+};
+
+// Опубликованная версия PersistentSet для схемы «один писатель, много
+// читателей». snapshot() — одна атомарная загрузка указателя на корень,
+// дальше читатель работает со своей версией без синхронизации.
+// Писатели сериализуются мьютексом, читателей он не касается.
+class VersionedSet {
+public:
+    VersionedSet();
+    explicit VersionedSet(PersistentSet initial);
+    VersionedSet(const VersionedSet&) = delete;
+    VersionedSet& operator=(const VersionedSet&) = delete;
+
+    PersistentSet snapshot() const;
+    std::uint64_t version() const;
+
+    // Публикует новую версию целиком
+    void publish(PersistentSet next);
+
+    // Строит новую версию из текущей и публикует её
+    PersistentSet update(const std::function<PersistentSet(const PersistentSet&)>& change);
+
+private:
+    std::shared_ptr<const PersistentSet> current_;
+    std::atomic<std::uint64_t> version_;
+    std::mutex writer_;
+};
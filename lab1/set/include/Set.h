@@ -1,81 +1,358 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
+#include "Atom.h"
+
+class BloomFilter;
+class SetProduct;
+class SubsetStore;
+class ThreadPool;
+struct StructuralIndex;
 
 class Set {
 public:
-    enum ElementType {
+    enum ElementType : std::uint8_t {
         VALUE,
         NESTED_SET
     };
 
+    struct Element;
+
+    // Неизменяемый список детей вложенного множества. Дети лежат сразу за
+    // заголовком узла в одном блоке памяти из memory_resource; копирование
+    // в пределах одного ресурса разделяет узел по счётчику ссылок, в другой
+    // ресурс — клонирует его. Пустой список памяти не занимает.
+    class Subset {
+    public:
+        using const_iterator = const Element*;
+
+        Subset();
+        explicit Subset(const std::vector<Element>& items);
+        explicit Subset(std::vector<Element>&& items);
+        // Переносит хвост items[from..] в новый узел и укорачивает items
+        Subset(std::vector<Element>& items, std::size_t from,
+               std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+        Subset(const Subset& other);
+        Subset(Subset&& other) noexcept;
+        Subset(const Subset& other, std::pmr::memory_resource* resource);
+        Subset(Subset&& other, std::pmr::memory_resource* resource);
+        Subset& operator=(const Subset& other);
+        Subset& operator=(Subset&& other) noexcept;
+        ~Subset();
+
+        std::size_t size() const;
+        bool empty() const;
+        const_iterator begin() const;
+        const_iterator end() const;
+        const Element& operator[](std::size_t index) const;
+        std::vector<Element> toVector() const;
+        bool sharesNodeWith(const Subset& other) const;
+        std::pmr::memory_resource* resource() const;
+        // Структурный хеш содержимого (ElementHash вложенного множества);
+        // вычисляется один раз и хранится в узле
+        std::uint64_t fingerprint() const;
+        // Хранилище, в котором узел канонический (SubsetStore.h), иначе nullptr
+        const SubsetStore* store() const;
+
+    private:
+        friend class Set;
+        friend class SubsetStore;
+        struct Node;
+        Node* node_;
+
+        void setStore(const SubsetStore* store) const;
+
+        void adopt(Element* items, std::size_t count, bool move, std::pmr::memory_resource* resource);
+        void release();
+    };
+
+    // Элемент — помеченный дескриптор: номер интернированного атома
+    // либо ссылка на узел с детьми (16 байт вместо строки и вектора)
     struct Element {
+        // Элемент учитывает аллокатор контейнера: при вставке в
+        // std::pmr::vector его узлы оказываются в ресурсе этого вектора
+        using allocator_type = std::pmr::polymorphic_allocator<Element>;
+
         ElementType type;
-        std::string atom;
-        std::vector<Element> subset;
+        Atom atom;
+        Subset subset;
 
         Element();
+        explicit Element(const allocator_type& allocator);
+        Element(const Element& other) = default;
+        Element(Element&& other) = default;
+        Element(const Element& other, const allocator_type& allocator);
+        Element(Element&& other, const allocator_type& allocator);
+        Element& operator=(const Element& other) = default;
+        Element& operator=(Element&& other) = default;
+        explicit Element(const char* value);
         Element(const std::string& value);
+        explicit Element(Atom value);
         Element(const std::vector<Element>& nested);
+        Element(std::vector<Element>&& nested);
+        explicit Element(Subset nested);
 
         friend bool operator==(const Element& lhs, const Element& rhs);
         friend bool operator!=(const Element& lhs, const Element& rhs);
     };
 
-    // Конструкторы и присваивание
+    // Структурный хеш: не зависит от порядка и повторов детей,
+    // поэтому согласован с operator== для элементов
+    struct ElementHash {
+        std::size_t operator()(const Element& element) const;
+    };
+
+    using const_iterator = std::pmr::vector<Element>::const_iterator;
+
+    // Конструкторы и присваивание. Множество может размещать всё дерево
+    // элементов в переданном memory_resource (например, в
+    // std::pmr::monotonic_buffer_resource); результаты разбора, powerSet и
+    // операций над множествами создаются в ресурсе левого операнда.
+    // Копирование конструктором копии, как принято в pmr, идёт в ресурс
+    // по умолчанию.
     Set();
+    explicit Set(std::pmr::memory_resource* resource);
     explicit Set(const std::string& serialized);
+    Set(const std::string& serialized, std::pmr::memory_resource* resource);
     explicit Set(const std::vector<Element>& items);
+    // Массовое построение: дубликаты удаляются хешированием за O(n),
+    // начиная с PARALLEL_THRESHOLD элементов — по хеш-разделам в пуле потоков
+    explicit Set(std::vector<Element>&& items);
+    template <class InputIt>
+    Set(InputIt first, InputIt last) : storage_(first, last) {
+        eliminateDuplicates();
+    }
     Set(const Set& other);
-    ~Set() = default;
+    Set(const Set& other, std::pmr::memory_resource* resource);
+    Set(Set&& other) noexcept;
+    ~Set();
 
     Set& operator=(const Set& other);
+    // При разных ресурсах элементы переносятся с копированием узлов,
+    // поэтому присваивание может выбросить std::bad_alloc
+    Set& operator=(Set&& other);
 
     // Основные методы
     bool contains(const Element& item) const;
     bool isEmpty() const;
     std::size_t size() const;
     void insert(const Element& item);
+    void insert(Element&& item);
+    template <class... Args>
+    void emplace(Args&&... args) {
+        insert(Element(std::forward<Args>(args)...));
+    }
     void erase(const Element& item);
 
+    // Фильтр Блума отсекает промахи contains/has до сравнения элементов.
+    // Строится при первом запросе к множеству от FILTER_THRESHOLD
+    // элементов с запасом ёмкости вдвое и пополняется вставками; после
+    // переполнения или удаления половины записей строится заново.
+    static constexpr std::size_t FILTER_THRESHOLD = 64;
+    struct FilterStats {
+        bool active;
+        std::size_t entries;
+        std::size_t bits;
+        std::size_t bytes;
+        double falsePositiveRate;
+    };
+    void setFilterEnabled(bool enabled);
+    FilterStats filterStats() const;
+
+    // Обход элементов
+    const_iterator begin() const;
+    const_iterator end() const;
+    std::pmr::memory_resource* resource() const;
+
     // Операции над множествами
-    Set unite(const Set& other) const;
+    // Перегрузки для && переиспользуют память истекающего левого операнда
+    Set unite(const Set& other) const &;
+    Set unite(const Set& other) &&;
     Set& selfUnite(const Set& other);
-    Set intersect(const Set& other) const;
+    Set intersect(const Set& other) const &;
+    Set intersect(const Set& other) &&;
     Set& selfIntersect(const Set& other);
-    Set difference(const Set& other) const;
+    Set difference(const Set& other) const &;
+    Set difference(const Set& other) &&;
     Set& selfDifference(const Set& other);
+    // Параллельные версии для больших множеств: от PARALLEL_THRESHOLD
+    // элементов в сумме оба операнда делятся по хешу между потоками пула,
+    // разделы обрабатываются независимо и результаты склеиваются по
+    // порядку разделов, так что порядок элементов отличается от
+    // последовательных версий. Меньшие операнды идут последовательным
+    // путём с хеш-индексом.
+    Set parallelUnite(const Set& other) const;
+    Set parallelUnite(const Set& other, ThreadPool& pool) const;
+    Set parallelIntersect(const Set& other) const;
+    Set parallelIntersect(const Set& other, ThreadPool& pool) const;
+    Set parallelDifference(const Set& other) const;
+    Set parallelDifference(const Set& other, ThreadPool& pool) const;
+    // Элементы ровно одного из множеств: по одному проходу по каждому
+    // операнду с проверкой по хеш-индексу другого
+    Set symmetricDifference(const Set& other) const;
+    // Декартово произведение как ленивый вид (SetProduct.h); вид ссылается
+    // на оба множества, поэтому временные множители запрещены
+    SetProduct product(const Set& other) const &;
+    SetProduct product(const Set&& other) const & = delete;
+    SetProduct product(const Set& other) const && = delete;
+    SetProduct product(const Set&& other) const && = delete;
+
+    // Операции над наборами множеств: объединение одним хеш-проходом,
+    // пересечение от меньшего множества к большему с ранним выходом.
+    // При parallel и суммарном размере от PARALLEL_THRESHOLD работа
+    // делится между потоками ThreadPool::shared(). Порядок элементов
+    // результата от этого не зависит: объединение идёт в порядке первого
+    // появления, пересечение — в порядке наименьшего множества.
+    static constexpr std::size_t PARALLEL_THRESHOLD = 1 << 15;
+    static Set uniteAll(const std::vector<const Set*>& sets, bool parallel = false);
+    static Set intersectAll(const std::vector<const Set*>& sets, bool parallel = false);
+    template <class Range>
+    static Set uniteAll(const Range& sets, bool parallel = false) {
+        return uniteAll(pointersTo(sets), parallel);
+    }
+    template <class Range>
+    static Set intersectAll(const Range& sets, bool parallel = false) {
+        return intersectAll(pointersTo(sets), parallel);
+    }
+
+    // Отношения между множествами без построения новых: сначала сравнение
+    // размеров, затем обход с выходом на первом свидетеле. Принадлежность
+    // проверяется по отсортированным отпечаткам (ElementHash) элементов
+    // другого множества; этот индекс строится один раз и сбрасывается при
+    // изменении множества, отпечатки вложенных элементов хранятся в узлах.
+    // Построение индекса выделяет память; дальше проверки обходятся без
+    // кучи, кроме сравнения равных по отпечатку вложенных элементов с
+    // разным порядком детей.
+    bool isSubsetOf(const Set& other) const;
+    bool isSupersetOf(const Set& other) const;
+    bool isDisjointFrom(const Set& other) const;
+    std::size_t intersectionSize(const Set& other) const;
 
     // Сравнение
     bool operator==(const Set& other) const;
     bool operator!=(const Set& other) const;
     bool has(const Element& item) const;
 
-    // Булеан
+    // Булеан. Подмножества различны по построению и добавляются без
+    // проверки принадлежности; вариант с хранилищем (SubsetStore.h)
+    // канонизирует их, так что булеаны пересекающихся множеств разделяют
+    // узлы общих подмножеств.
     Set powerSet() const;
+    Set powerSet(SubsetStore& store) const;
+
+    // Заменяет вложенные элементы каноническими узлами хранилища; ресурс
+    // хранилища должен совпадать с ресурсом множества
+    void internNested(SubsetStore& store);
+
+    // Память. memoryUsage — байты объекта, буфера элементов с запасом
+    // ёмкости, узлов вложенных множеств (разделяемый узел считается один
+    // раз) и кучи строк различных атомов. compact освобождает запас
+    // ёмкости и заменяет одинаковые вложенные множества одним общим узлом.
+    std::size_t memoryUsage() const;
+    void compact();
+
+    // Хеш содержимого: не зависит от порядка элементов и согласован с
+    // operator==; совпадает с ElementHash вложенного множества тех же
+    // элементов. Вычисляется один раз, как и текст serialize; оба кеша
+    // сбрасываются вставкой, удалением, self*-операциями и присваиванием.
+    std::uint64_t contentHash() const;
 
     // Сериализация
     std::string serialize() const;
-    static Set deserialize(const std::string& input);
+    static Set deserialize(std::string_view input,
+                           std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Двоичный формат: varint-длины, таблица уникальных атомов,
+    // теги вложенности и необязательная контрольная сумма FNV-1a
+    std::string serializeBinary(bool withHash = true) const;
+    static Set deserializeBinary(std::string_view data);
+    static Set loadBinaryFile(const std::string& path);
 
     // Потоковые операторы (дружественные функции)
     friend std::ostream& operator<<(std::ostream& os, const Set& set);
     friend std::istream& operator>>(std::istream& is, Set& set);
 
 private:
-    std::vector<Element> storage_;
+    template <class Derived>
+    friend class SetExpression;
+    friend class PersistentSet;
+
+    std::pmr::vector<Element> storage_;
+    // Кеши для const-методов: текст читается и публикуется через
+    // std::atomic_load/atomic_store, 0 в hash_ означает «не вычислен»
+    mutable std::shared_ptr<const std::string> serialized_;
+    mutable std::atomic<std::uint64_t> hash_{0};
+    // Фильтр принадлежит множеству; const-методы публикуют его через CAS
+    mutable std::atomic<BloomFilter*> filter_{nullptr};
+    bool filterEnabled_ = true;
+    struct FingerprintIndex;
+    mutable std::atomic<FingerprintIndex*> fingerprints_{nullptr};
+
+    void invalidate();
+    const BloomFilter* membershipFilter() const;
+    bool scan(const Element& item) const;
+    bool absent(const Element& item, std::uint64_t& hash) const;
+    void filterInserted(std::uint64_t hash);
+    void filterRemoved(std::size_t count);
+    void dropFilter();
+    const FingerprintIndex& fingerprintIndex() const;
+    bool holds(const Element& item) const;
+    void dropFingerprints();
+    std::shared_ptr<const std::string> serializedText() const;
 
     // Внутренние методы парсинга
-    Element parseAtomic(const std::string& str, std::size_t& index) const;
-    Element parseGroup(const std::string& str, std::size_t& index) const;
-    void loadFromString(const std::string& str);
+    // Разбор идёт циклом с явным стеком открытых групп, поэтому глубина
+    // вложенности не ограничена стеком вызовов
+    Element parseToken(std::string_view str, std::size_t& index) const;
+    Element tokenElement(std::string_view raw) const;
+    void parseGroups(std::string_view str, std::size_t& index, std::vector<Element>& scratch) const;
+    // Быстрый путь по индексу StructuralScanner; false — вход нужно
+    // разобрать посимвольно (в том числе чтобы получить текст ошибки)
+    bool parseIndexed(std::string_view str, std::size_t first, const StructuralIndex& index,
+                      std::vector<Element>& scratch) const;
+    void loadFromString(std::string_view str);
 
     // Вспомогательные методы
+    template <class Range>
+    static std::vector<const Set*> pointersTo(const Range& sets) {
+        std::vector<const Set*> pointers;
+        for (const Set& set : sets) {
+            pointers.push_back(&set);
+        }
+        return pointers;
+    }
+    // До этого размера дубликаты ищутся попарным сравнением, а операции
+    // над множествами проверяют принадлежность перебором без хеш-индекса
+    static constexpr std::size_t SMALL_DEDUP = 16;
+    enum class Algebra {
+        UNITE,
+        INTERSECT,
+        DIFFERENCE
+    };
+    Set partitioned(const Set& other, Algebra operation, ThreadPool& pool) const;
     void eliminateDuplicates();
-    std::string stringifyElement(const Element& elem) const;
+    void appendElement(std::string& out, const Element& elem) const;
+    void skipWhitespace(std::string_view str, std::size_t& index) const;
     bool isWhitespace(char c) const;
     bool isDigit(char c) const;
     bool isLetter(char c) const;
 };
+
+// Множества как ключи неупорядоченных контейнеров
+namespace std {
+template <>
+struct hash<Set> {
+    std::size_t operator()(const Set& set) const {
+        return static_cast<std::size_t>(set.contentHash());
+    }
+};
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "Set.h"
+
+// Инвертированный индекс над набором множеств: каждому элементу (по
+// структурному хешу Set::ElementHash) сопоставлен отсортированный список
+// номеров множеств, где он встречается. Запросы принадлежности,
+// подмножеств, надмножеств и сходства Жаккара сводятся к пересечению и
+// подсчёту по спискам вместо перебора всех множеств.
+class SetCollection {
+public:
+    using SetId = std::uint32_t;
+
+    struct Match {
+        SetId id;
+        double similarity;
+    };
+
+    SetCollection();
+
+    // Изменение набора; номера удалённых множеств повторно не выдаются
+    SetId add(const Set& set);
+    void update(SetId id, const Set& set);
+    void remove(SetId id);
+
+    bool has(SetId id) const;
+    const Set& get(SetId id) const;
+    std::size_t size() const;
+
+    // Запросы; результаты упорядочены по номеру множества
+    std::vector<SetId> containing(const Set::Element& element) const;
+    std::vector<SetId> supersetsOf(const Set& query) const;
+    std::vector<SetId> subsetsOf(const Set& query) const;
+    std::vector<Match> similarTo(const Set& query, double threshold) const;
+
+private:
+    using Postings = std::vector<SetId>;
+    // Число общих с запросом элементов по номерам затронутых множеств:
+    // запрос стоит O(суммы длин его списков), а не O(числа множеств)
+    using Counts = std::unordered_map<SetId, std::uint32_t>;
+
+    std::vector<std::optional<Set>> sets_;
+    std::unordered_map<Set::Element, Postings, Set::ElementHash> postings_;
+    Postings empty_;
+    std::size_t live_;
+
+    void index(SetId id, const Set& set);
+    void unindex(SetId id, const Set& set);
+    const Set& checked(SetId id) const;
+    // Считает общие с запросом элементы каждого множества и возвращает
+    // номера множеств, где они есть
+    std::vector<SetId> overlaps(const Set& query, Counts& counts) const;
+};
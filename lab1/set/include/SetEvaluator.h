@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include "Set.h"
+
+// Вычисление выражений над литералами множеств: | (объединение),
+// & (пересечение), - (разность), ^ (симметрическая разность) и скобки.
+// & связывает сильнее остальных операций, операции одного уровня
+// выполняются слева направо. Строка из одного литерала — тоже выражение.
+// Разбор идёт алгоритмом сортировочной станции с явными стеками операндов
+// и операций, поэтому глубина скобок не ограничена стеком вызовов.
+class SetEvaluator {
+public:
+    static Set evaluate(std::string_view expression);
+
+private:
+    std::string_view input_;
+    std::size_t pos_;
+
+    explicit SetEvaluator(std::string_view input);
+
+    Set parseExpression();
+    Set parseLiteral();
+    static int precedence(char operation);
+    static void apply(std::vector<Set>& operands, char operation);
+    bool consume(char expected);
+    void skipWhitespace();
+};
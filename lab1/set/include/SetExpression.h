@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "ElementIndex.h"
+#include "Set.h"
+
+// Ленивые выражения над Set. Операторы |, &, - и ^ строят дерево без
+// промежуточных множеств; при присваивании в Set или обходе через forEach
+// выражение вычисляется одним проходом: каждый кандидат проверяется сразу
+// по всем операндам через их хеш-индексы. Индексы строятся заново при
+// каждом вычислении и принадлежат ему: выражение не хранит состояния,
+// так что операнды можно менять между вычислениями, а одно выражение
+// вычислять из нескольких потоков.
+template <class Derived>
+class SetExpression {
+public:
+    const Derived& derived() const {
+        return static_cast<const Derived&>(*this);
+    }
+
+    template <class Visitor>
+    void forEach(Visitor visit) const {
+        // Индексы листьев в порядке обхода слева направо
+        std::vector<ElementIndex> indexes;
+        indexes.reserve(Derived::LEAVES);
+        derived().prepare(indexes);
+        const ElementIndex* leaves = indexes.data();
+        ElementIndex emitted;
+        derived().forEachCandidate([&](const Set::Element& element) {
+            if (derived().test(element, leaves) && emitted.insert(element)) {
+                visit(element);
+            }
+        });
+    }
+
+    Set evaluate() const {
+        Set result;
+        forEach([&result](const Set::Element& element) {
+            result.storage_.push_back(element);
+        });
+        return result;
+    }
+
+    operator Set() const {
+        return evaluate();
+    }
+
+    std::size_t size() const {
+        std::size_t count = 0;
+        forEach([&count](const Set::Element&) { ++count; });
+        return count;
+    }
+};
+
+// Лист выражения: ссылка на существующее множество. Временные множества
+// листьями быть не могут: выражение пережило бы их
+class SetOperand : public SetExpression<SetOperand> {
+public:
+    static constexpr std::size_t LEAVES = 1;
+
+    explicit SetOperand(const Set& set) : set_(&set) {}
+    explicit SetOperand(const Set&& set) = delete;
+
+    void prepare(std::vector<ElementIndex>& indexes) const {
+        indexes.emplace_back(*set_);
+    }
+
+    bool test(const Set::Element& element, const ElementIndex* leaves) const {
+        return leaves->contains(element);
+    }
+
+    template <class Visitor>
+    void forEachCandidate(Visitor&& visit) const {
+        for (const auto& element : *set_) visit(element);
+    }
+
+    std::size_t sizeHint() const {
+        return set_->size();
+    }
+
+private:
+    const Set* set_;
+};
+
+template <class Op, class L, class R>
+class BinarySetExpression : public SetExpression<BinarySetExpression<Op, L, R>> {
+public:
+    static constexpr std::size_t LEAVES = L::LEAVES + R::LEAVES;
+
+    BinarySetExpression(const L& left, const R& right) : left_(left), right_(right) {}
+
+    void prepare(std::vector<ElementIndex>& indexes) const {
+        left_.prepare(indexes);
+        right_.prepare(indexes);
+    }
+
+    // Индексы правого поддерева идут за индексами левого
+    bool test(const Set::Element& element, const ElementIndex* leaves) const {
+        return Op::test(left_, right_, element, leaves, leaves + L::LEAVES);
+    }
+
+    template <class Visitor>
+    void forEachCandidate(Visitor&& visit) const {
+        Op::candidates(left_, right_, visit);
+    }
+
+    std::size_t sizeHint() const {
+        return Op::sizeHint(left_, right_);
+    }
+
+private:
+    L left_;
+    R right_;
+};
+
+struct UnionOp {
+    template <class L, class R>
+    static bool test(const L& l, const R& r, const Set::Element& e,
+                     const ElementIndex* li, const ElementIndex* ri) {
+        return l.test(e, li) || r.test(e, ri);
+    }
+    template <class L, class R, class Visitor>
+    static void candidates(const L& l, const R& r, Visitor& visit) {
+        l.forEachCandidate(visit);
+        r.forEachCandidate(visit);
+    }
+    template <class L, class R>
+    static std::size_t sizeHint(const L& l, const R& r) { return l.sizeHint() + r.sizeHint(); }
+};
+
+struct IntersectionOp {
+    template <class L, class R>
+    static bool test(const L& l, const R& r, const Set::Element& e,
+                     const ElementIndex* li, const ElementIndex* ri) {
+        return l.test(e, li) && r.test(e, ri);
+    }
+    // Кандидаты берутся из меньшего операнда
+    template <class L, class R, class Visitor>
+    static void candidates(const L& l, const R& r, Visitor& visit) {
+        if (l.sizeHint() <= r.sizeHint()) {
+            l.forEachCandidate(visit);
+        } else {
+            r.forEachCandidate(visit);
+        }
+    }
+    template <class L, class R>
+    static std::size_t sizeHint(const L& l, const R& r) {
+        return l.sizeHint() < r.sizeHint() ? l.sizeHint() : r.sizeHint();
+    }
+};
+
+struct DifferenceOp {
+    template <class L, class R>
+    static bool test(const L& l, const R& r, const Set::Element& e,
+                     const ElementIndex* li, const ElementIndex* ri) {
+        return l.test(e, li) && !r.test(e, ri);
+    }
+    template <class L, class R, class Visitor>
+    static void candidates(const L& l, const R&, Visitor& visit) {
+        l.forEachCandidate(visit);
+    }
+    template <class L, class R>
+    static std::size_t sizeHint(const L& l, const R&) { return l.sizeHint(); }
+};
+
+struct SymmetricDifferenceOp {
+    template <class L, class R>
+    static bool test(const L& l, const R& r, const Set::Element& e,
+                     const ElementIndex* li, const ElementIndex* ri) {
+        return l.test(e, li) != r.test(e, ri);
+    }
+    template <class L, class R, class Visitor>
+    static void candidates(const L& l, const R& r, Visitor& visit) {
+        l.forEachCandidate(visit);
+        r.forEachCandidate(visit);
+    }
+    template <class L, class R>
+    static std::size_t sizeHint(const L& l, const R& r) { return l.sizeHint() + r.sizeHint(); }
+};
+
+inline SetOperand lazy(const Set& set) {
+    return SetOperand(set);
+}
+
+SetOperand lazy(const Set&& set) = delete;
+
+#define SET_EXPRESSION_OPERATOR(symbol, Op)                                                   \
+    template <class L, class R>                                                               \
+    BinarySetExpression<Op, L, R> operator symbol(const SetExpression<L>& l,                  \
+                                                  const SetExpression<R>& r) {                \
+        return BinarySetExpression<Op, L, R>(l.derived(), r.derived());                       \
+    }                                                                                         \
+    template <class L>                                                                        \
+    BinarySetExpression<Op, L, SetOperand> operator symbol(const SetExpression<L>& l,         \
+                                                           const Set& r) {                    \
+        return BinarySetExpression<Op, L, SetOperand>(l.derived(), SetOperand(r));            \
+    }                                                                                         \
+    template <class R>                                                                        \
+    BinarySetExpression<Op, SetOperand, R> operator symbol(const Set& l,                      \
+                                                           const SetExpression<R>& r) {       \
+        return BinarySetExpression<Op, SetOperand, R>(SetOperand(l), r.derived());            \
+    }                                                                                         \
+    template <class L>                                                                        \
+    BinarySetExpression<Op, L, SetOperand> operator symbol(const SetExpression<L>& l,         \
+                                                           const Set&& r) = delete;           \
+    template <class R>                                                                        \
+    BinarySetExpression<Op, SetOperand, R> operator symbol(const Set&& l,                     \
+                                                           const SetExpression<R>& r) = delete;
+
+SET_EXPRESSION_OPERATOR(|, UnionOp)
+SET_EXPRESSION_OPERATOR(&, IntersectionOp)
+SET_EXPRESSION_OPERATOR(-, DifferenceOp)
+SET_EXPRESSION_OPERATOR(^, SymmetricDifferenceOp)
+
+#undef SET_EXPRESSION_OPERATOR
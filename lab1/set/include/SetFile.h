@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "BinaryFormat.h"
+#include "MappedFile.h"
+#include "Set.h"
+
+// Индексированный файл множества с доступом к отдельным элементам без
+// загрузки всего файла. Элементы верхнего уровня записываются блоками
+// примерно по CHUNK_BYTES в кодировке ElementEncoder (своя таблица атомов
+// в каждом блоке), блоки сжимаются zlib, если сборка с ним. За блоками
+// идут таблицы фиксированной ширины и завершающий заголовок:
+//   блоки:     смещение, размер на диске, исходный размер, FNV-1a блока;
+//   элементы:  (номер блока << 32) | смещение в распакованном блоке;
+//   хеши:      (устойчивый хеш, номер элемента), по возрастанию хеша.
+// Файл отображается в память, таблицы читаются прямо из отображения:
+// contains — двоичный поиск по хешам и распаковка одного блока, fetch —
+// распаковка блока элемента. Последний распакованный блок кешируется.
+// Хеш не зависит от номеров атомов текущего процесса, поэтому файл
+// переносим между запусками.
+class SetFile {
+public:
+    static constexpr std::size_t CHUNK_BYTES = 1 << 16;
+
+    static void write(const Set& set, const std::string& path, bool compress = true);
+
+    explicit SetFile(const std::string& path);
+
+    std::size_t size() const;
+    bool empty() const;
+    std::size_t chunkCount() const;
+    bool compressed() const;
+
+    bool contains(const Set::Element& element) const;
+    Set::Element fetch(std::size_t index) const;
+
+    // Потоковый обход блок за блоком и загрузка всего множества
+    void forEach(const std::function<void(const Set::Element&)>& visitor) const;
+    Set load() const;
+
+    // Полная проверка: контрольная сумма таблиц и всех блоков
+    void verify() const;
+
+private:
+    struct Chunk {
+        std::string raw;
+        ElementDecoder decoder;
+    };
+
+    MappedFile file_;
+    std::string_view data_;
+    std::uint64_t chunkTable_;
+    std::uint64_t elementTable_;
+    std::uint64_t hashTable_;
+    std::uint64_t chunks_;
+    std::uint64_t elements_;
+    std::uint64_t indexHash_;
+    bool compressed_;
+
+    // Кеш последнего распакованного блока
+    mutable std::mutex mutex_;
+    mutable std::uint64_t cachedIndex_;
+    mutable Chunk cached_;
+
+    std::uint64_t fixed64(std::uint64_t offset) const;
+    void unpack(std::uint64_t index, Chunk& chunk) const;
+    Set::Element decode(std::uint64_t index) const;
+};
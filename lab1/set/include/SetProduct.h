@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include "Set.h"
+
+// Ленивое декартово произведение двух множеств. Упорядоченная пара (a, b)
+// кодируется по Куратовскому вложенным элементом {{a}, {a, b}} ({{a}} при
+// a = b) и строится только при обращении, поэтому обход не требует памяти
+// под всё произведение. Пары пронумерованы построчно: номер i даёт
+// (left[i / |right|], right[i % |right|]). Вид хранит ссылки на множители:
+// они должны жить дольше вида и не меняться, пока он используется.
+class SetProduct {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Set::Element;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Set::Element;
+
+        const_iterator(const SetProduct* product, std::size_t index);
+
+        Set::Element operator*() const;
+        const_iterator& operator++();
+        const_iterator operator++(int);
+        bool operator==(const const_iterator& other) const;
+        bool operator!=(const const_iterator& other) const;
+
+    private:
+        const SetProduct* product_;
+        std::size_t index_;
+    };
+
+    SetProduct(const Set& left, const Set& right);
+    // Вид на временное множество сразу стал бы висячим
+    SetProduct(const Set&& left, const Set& right) = delete;
+    SetProduct(const Set& left, const Set&& right) = delete;
+    SetProduct(const Set&& left, const Set&& right) = delete;
+
+    // Число пар; overflow_error, если оно не помещается в size_t
+    std::size_t size() const;
+    bool empty() const;
+    Set::Element operator[](std::size_t index) const;
+    Set::Element at(std::size_t index) const;
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    // Принадлежность пары без перебора: пара раскладывается на
+    // компоненты, и каждая ищется в своём множителе
+    bool contains(const Set::Element& pair) const;
+
+    template <class Visitor>
+    void forEach(Visitor visit) const {
+        for (const auto& a : *left_) {
+            for (const auto& b : *right_) {
+                visit(pair(a, b));
+            }
+        }
+    }
+
+    Set evaluate() const;
+
+    static Set::Element pair(const Set::Element& first, const Set::Element& second);
+    // Разбор пары Куратовского; false — элемент не является парой
+    static bool unpair(const Set::Element& pair, Set::Element& first, Set::Element& second);
+
+private:
+    const Set* left_;
+    const Set* right_;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Счётчики внутри операций Set, включаемые при сборке опцией
+// SET_ENABLE_STATS. Без неё макросы SET_STATS_* раскрываются в пустоту,
+// а snapshot() возвращает пустую таблицу.
+struct OperationStats {
+    std::uint64_t calls = 0;
+    std::uint64_t comparisons = 0;     // сравнения элементов
+    std::uint64_t allocations = 0;     // вызовы operator new, включая контейнеры и индексы
+    std::uint64_t bytesCopied = 0;     // байты скопированных элементов
+};
+
+class SetStats {
+public:
+#ifdef SET_ENABLE_STATS
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    // Счётчики по именам открытых операций; вложенные вызовы учитываются
+    // в самой внешней операции потока
+    static std::map<std::string, OperationStats> snapshot();
+    static void reset();
+
+    class Attach;
+
+    // Счётчики копятся в thread-local переменных потока и сливаются в
+    // таблицу один раз, при закрытии внешней операции. Задачи ThreadPool
+    // присоединяются к операции потока, вызвавшего parallelFor (Attach):
+    // их счётчики добавляются к ней по завершении задачи.
+    class Scope {
+    public:
+        explicit Scope(const char* operation);
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope();
+
+        // Внешняя операция, открытая в текущем потоке, иначе nullptr
+        static Scope* active();
+
+    private:
+        friend class Attach;
+        const char* operation_;
+        std::mutex mutex_;
+        OperationStats workers_;
+    };
+
+    class Attach {
+    public:
+        explicit Attach(Scope* scope);
+        Attach(const Attach&) = delete;
+        Attach& operator=(const Attach&) = delete;
+        ~Attach();
+
+    private:
+        Scope* scope_;
+        Scope* savedActive_;
+        unsigned savedDepth_;
+        OperationStats saved_;
+    };
+
+    static void count(std::uint64_t OperationStats::*field, std::uint64_t amount);
+
+    // Все вызовы operator new процесса с последнего resetHeap. В сборке со
+    // статистикой operator new заменён в SetStats.cpp, и бенчмарки читают
+    // счётчики отсюда
+    static std::uint64_t heapAllocations();
+    static std::uint64_t heapBytes();
+    static void resetHeap();
+};
+
+#ifdef SET_ENABLE_STATS
+#define SET_STATS_OPERATION(name) SetStats::Scope setStatsScope(name)
+#define SET_STATS_COUNT(field, amount) SetStats::count(&OperationStats::field, (amount))
+#else
+#define SET_STATS_OPERATION(name) ((void)0)
+#define SET_STATS_COUNT(field, amount) ((void)0)
+#endif
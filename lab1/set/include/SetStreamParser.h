@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Set.h"
+
+// Инкрементальный (push) разборщик текстового формата Set.
+// Вход подаётся частями через feed(); буфер чтения не зависит от размера
+// входа. Разборщик хранит недочитанный токен и открытые группы вместе с
+// уже разобранными детьми, так что вложенный элемент целиком лежит в
+// памяти, пока не закроется его группа.
+// В потоковом режиме элементы верхнего уровня передаются обработчику
+// по мере закрытия и не накапливаются: память ограничена размером
+// наибольшего элемента верхнего уровня. Без обработчика из них
+// постепенно строится Set, и память растёт с размером входа.
+class SetStreamParser {
+public:
+    using ElementHandler = std::function<void(Set::Element&&)>;
+
+    static constexpr std::size_t DEFAULT_CHUNK_SIZE = 1 << 16;
+
+    SetStreamParser();
+    explicit SetStreamParser(ElementHandler handler);
+
+    void feed(std::string_view chunk);
+    void finish();
+    bool isFinished() const;
+    std::size_t depth() const;
+    Set takeSet();
+
+    // Сборка Set из istream, файлового дескриптора или отображённого файла
+    static Set read(std::istream& is, std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+    static Set readFd(int fd, std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+    static Set readFile(const std::string& path, std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+    // Потоковый режим: элементы верхнего уровня передаются обработчику
+    static void stream(std::istream& is, ElementHandler handler,
+                       std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+    static void streamFd(int fd, ElementHandler handler,
+                         std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+    static void streamFile(const std::string& path, ElementHandler handler,
+                           std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+private:
+    enum State {
+        BEFORE_ROOT,
+        EXPECT_ELEMENT,
+        IN_TOKEN,
+        AFTER_ELEMENT,
+        DONE
+    };
+
+    State state_;
+    ElementHandler handler_;
+    // Открытые группы; нижний кадр — корень, он пуст в потоковом режиме
+    std::vector<std::vector<Set::Element>> stack_;
+    std::string token_;
+    Set result_;
+
+    void consume(char c);
+    void openGroup();
+    void closeGroup();
+    void finishToken();
+    void emit(Set::Element&& element);
+
+    void pump(std::istream& is, std::size_t chunkSize);
+    void pumpFd(int fd, std::size_t chunkSize);
+    void pumpFile(const std::string& path, std::size_t chunkSize);
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Первый проход разбора в духе simdjson: текст классифицируется блоками по
+// 16 (SSE2) или 32 (AVX2) байт, а на выходе получается список позиций
+// структурных символов '{', '}' и ','. Заодно проверяется, что во входе
+// нет байтов вне алфавита формата; тогда разбор может идти по индексу,
+// не проверяя каждый символ токена.
+struct StructuralIndex {
+    std::vector<std::uint32_t> positions;
+    bool valid = true;
+};
+
+class StructuralScanner {
+public:
+    enum class Kernel { SCALAR, SSE2, AVX2 };
+
+    // Лучшее ядро, доступное на этом процессоре
+    static Kernel best();
+    static StructuralIndex scan(std::string_view input);
+    static StructuralIndex scan(std::string_view input, Kernel kernel);
+};
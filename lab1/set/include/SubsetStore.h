@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <unordered_set>
+#include "Set.h"
+
+// Хеш-консинг вложенных множеств: каждому содержимому (с точностью до
+// порядка и повторов детей) соответствует один неизменяемый канонический
+// узел — первый встреченный представитель. Дети канонизируются снизу
+// вверх, поэтому равные поддеревья хранятся однажды, а равенство двух
+// элементов, канонических в одном хранилище, сводится к сравнению узлов.
+// Новые узлы создаются в ресурсе хранилища: он должен жить дольше
+// множеств, получивших эти узлы. Глобальное хранилище, как и AtomTable,
+// не разрушается.
+class SubsetStore {
+public:
+    explicit SubsetStore(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    SubsetStore(const SubsetStore&) = delete;
+    SubsetStore& operator=(const SubsetStore&) = delete;
+    ~SubsetStore();
+
+    static SubsetStore& global();
+
+    Set::Subset intern(const Set::Subset& subset);
+    // Атомы возвращаются как есть
+    Set::Element intern(const Set::Element& element);
+
+    std::size_t size() const;
+    std::pmr::memory_resource* resource() const;
+
+private:
+    std::pmr::memory_resource* resource_;
+    std::unordered_set<Set::Element, Set::ElementHash> canonical_;
+    mutable std::mutex mutex_;
+
+    Set::Subset find(const Set::Subset& subset) const;
+    Set::Subset canonicalize(const Set::Subset& subset);
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Пул потоков фиксированного размера для параллельных операций над Set.
+// Поток, вызвавший parallelFor, тоже выполняет задачи из очереди, пока
+// ждёт завершения, поэтому вложенные вызовы не блокируют пул. Пул без
+// рабочих потоков допустим: тогда всё выполняет вызывающий поток.
+class ThreadPool {
+public:
+    explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency());
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    static ThreadPool& shared();
+
+    std::size_t size() const;
+
+    // Делит [0, count) на части и вызывает body(begin, end) для каждой
+    void parallelFor(std::size_t count, const std::function<void(std::size_t, std::size_t)>& body);
+
+private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable taskReady_;
+    std::condition_variable taskDone_;
+    bool stopping_;
+
+    void workerLoop();
+};
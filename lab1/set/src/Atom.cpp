@@ -0,0 +1,231 @@
+#include "Atom.h"
+#include <stdexcept>
+
+AtomTable& AtomTable::instance() {
+    // Таблица не разрушается: атомы могут понадобиться деструкторам
+    // статических объектов, а номера действительны до конца программы
+    static AtomTable* table = new AtomTable();
+    return *table;
+}
+
+AtomTable::Index::Index(std::size_t capacity)
+    : mask(capacity - 1), slots(new std::atomic<std::uint64_t>[capacity]) {
+    for (std::size_t i = 0; i < capacity; ++i) {
+        slots[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+AtomTable::AtomTable() : size_(0) {
+    for (auto& segment : segments_) {
+        segment.store(nullptr, std::memory_order_relaxed);
+    }
+    indexes_.push_back(std::make_unique<Index>(4096));
+    index_.store(indexes_.back().get(), std::memory_order_release);
+    intern("");
+}
+
+void AtomTable::locate(std::uint32_t id, std::size_t& segment, std::size_t& offset) {
+    // Сегмент s содержит FIRST_SEGMENT << s строк
+    std::uint64_t slot = id / FIRST_SEGMENT + 1;
+    segment = static_cast<std::size_t>(63 - __builtin_clzll(slot));
+    offset = id - FIRST_SEGMENT * ((std::uint64_t(1) << segment) - 1);
+}
+
+std::uint32_t AtomTable::hashOf(std::string_view value) {
+    std::uint64_t hash = std::hash<std::string_view>()(value);
+    return static_cast<std::uint32_t>(hash ^ (hash >> 32));
+}
+
+std::uint32_t AtomTable::find(const Index& index, std::string_view value, std::uint32_t hash) const {
+    for (std::size_t i = hash & index.mask;; i = (i + 1) & index.mask) {
+        std::uint64_t slot = index.slots[i].load(std::memory_order_acquire);
+        if (slot == 0) return NOT_FOUND;
+        if (static_cast<std::uint32_t>(slot >> 32) == hash) {
+            std::uint32_t id = static_cast<std::uint32_t>(slot) - 1;
+            if (lookup(id) == value) return id;
+        }
+    }
+}
+
+void AtomTable::place(Index& index, std::uint32_t hash, std::uint32_t id) {
+    std::size_t i = hash & index.mask;
+    while (index.slots[i].load(std::memory_order_relaxed) != 0) {
+        i = (i + 1) & index.mask;
+    }
+    index.slots[i].store((std::uint64_t(hash) << 32) | (std::uint64_t(id) + 1), std::memory_order_release);
+}
+
+// Удаление со сдвигом назад: записи за дырой, чей домашний слот не
+// лежит между дырой и ними, переносятся в неё, так что цепочки поиска
+// остаются непрерывными без надгробий
+void AtomTable::erase(Index& index, std::uint32_t hash, std::uint32_t id) {
+    const std::uint64_t target = (std::uint64_t(hash) << 32) | (std::uint64_t(id) + 1);
+    std::size_t hole = hash & index.mask;
+    while (index.slots[hole].load(std::memory_order_relaxed) != target) {
+        hole = (hole + 1) & index.mask;
+    }
+    for (std::size_t i = (hole + 1) & index.mask;; i = (i + 1) & index.mask) {
+        const std::uint64_t slot = index.slots[i].load(std::memory_order_relaxed);
+        if (slot == 0) break;
+        const std::size_t home = static_cast<std::uint32_t>(slot >> 32) & index.mask;
+        const bool reachable = hole <= i ? hole < home && home <= i : hole < home || home <= i;
+        if (!reachable) {
+            index.slots[hole].store(slot, std::memory_order_relaxed);
+            hole = i;
+        }
+    }
+    index.slots[hole].store(0, std::memory_order_relaxed);
+}
+
+void AtomTable::truncate(std::uint32_t mark) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::uint32_t size = size_.load(std::memory_order_relaxed);
+    if (mark >= size) return;
+    Index& index = *index_.load(std::memory_order_relaxed);
+    for (std::uint32_t id = size; id-- > mark;) {
+        std::size_t segment, offset;
+        locate(id, segment, offset);
+        std::string& value = segments_[segment].load(std::memory_order_relaxed)[offset];
+        erase(index, hashOf(value), id);
+        std::string().swap(value);
+    }
+    size_.store(mark, std::memory_order_release);
+    // Сегменты, целиком лежащие за отметкой, возвращаются; индекс
+    // сохраняет размер, достигнутый внутри области
+    for (std::size_t segment = 1; segment < SEGMENTS; ++segment) {
+        if (FIRST_SEGMENT * ((std::uint64_t(1) << segment) - 1) >= mark) {
+            delete[] segments_[segment].exchange(nullptr, std::memory_order_relaxed);
+        }
+    }
+    // Прежние копии индекса больше никто не читает
+    indexes_.erase(indexes_.begin(), indexes_.end() - 1);
+}
+
+AtomTable::Epoch::Epoch() : mark_(static_cast<std::uint32_t>(AtomTable::instance().size())) {}
+
+AtomTable::Epoch::~Epoch() {
+    AtomTable::instance().truncate(mark_);
+}
+
+std::uint32_t AtomTable::intern(std::string_view value) {
+    const std::uint32_t hash = hashOf(value);
+    std::uint32_t id = find(*index_.load(std::memory_order_acquire), value, hash);
+    if (id != NOT_FOUND) return id;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Index* index = index_.load(std::memory_order_relaxed);
+    id = find(*index, value, hash);
+    if (id != NOT_FOUND) return id;
+
+    id = size_.load(std::memory_order_relaxed);
+    std::size_t segment, offset;
+    locate(id, segment, offset);
+    if (segment >= SEGMENTS) {
+        throw std::length_error("Atom table is full");
+    }
+    std::string* strings = segments_[segment].load(std::memory_order_relaxed);
+    if (strings == nullptr) {
+        strings = new std::string[FIRST_SEGMENT << segment];
+        segments_[segment].store(strings, std::memory_order_release);
+    }
+    strings[offset].assign(value.data(), value.size());
+
+    // Заполнение индекса не превышает половины
+    if ((static_cast<std::size_t>(id) + 1) * 2 > index->mask + 1) {
+        auto grown = std::make_unique<Index>((index->mask + 1) * 2);
+        for (std::size_t i = 0; i <= index->mask; ++i) {
+            std::uint64_t slot = index->slots[i].load(std::memory_order_relaxed);
+            if (slot != 0) {
+                place(*grown, static_cast<std::uint32_t>(slot >> 32), static_cast<std::uint32_t>(slot) - 1);
+            }
+        }
+        index = grown.get();
+        indexes_.push_back(std::move(grown));
+        index_.store(index, std::memory_order_release);
+    }
+    place(*index, hash, id);
+    size_.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+const std::string& AtomTable::lookup(std::uint32_t id) const {
+    std::size_t segment, offset;
+    locate(id, segment, offset);
+    return segments_[segment].load(std::memory_order_acquire)[offset];
+}
+
+std::size_t AtomTable::size() const {
+    return size_.load(std::memory_order_acquire);
+}
+
+Atom::Atom() : id_(0) {}
+
+Atom::Atom(const char* value) : id_(AtomTable::instance().intern(value)) {}
+
+Atom::Atom(const std::string& value) : id_(AtomTable::instance().intern(value)) {}
+
+Atom::Atom(std::string_view value) : id_(AtomTable::instance().intern(value)) {}
+
+const std::string& Atom::str() const {
+    return AtomTable::instance().lookup(id_);
+}
+
+Atom::operator const std::string&() const {
+    return str();
+}
+
+std::uint32_t Atom::id() const {
+    return id_;
+}
+
+std::size_t Atom::size() const {
+    return str().size();
+}
+
+bool Atom::empty() const {
+    return id_ == 0;
+}
+
+bool operator==(const Atom& lhs, const Atom& rhs) {
+    return lhs.id_ == rhs.id_;
+}
+
+bool operator!=(const Atom& lhs, const Atom& rhs) {
+    return lhs.id_ != rhs.id_;
+}
+
+bool operator==(const Atom& lhs, const std::string& rhs) {
+    return lhs.str() == rhs;
+}
+
+bool operator!=(const Atom& lhs, const std::string& rhs) {
+    return !(lhs == rhs);
+}
+
+bool operator==(const std::string& lhs, const Atom& rhs) {
+    return rhs == lhs;
+}
+
+bool operator!=(const std::string& lhs, const Atom& rhs) {
+    return !(rhs == lhs);
+}
+
+bool operator==(const Atom& lhs, const char* rhs) {
+    return lhs.str() == rhs;
+}
+
+bool operator!=(const Atom& lhs, const char* rhs) {
+    return !(lhs == rhs);
+}
+
+bool operator==(const char* lhs, const Atom& rhs) {
+    return rhs == lhs;
+}
+
+bool operator!=(const char* lhs, const Atom& rhs) {
+    return !(rhs == lhs);
+}
+
+std::ostream& operator<<(std::ostream& os, const Atom& atom) {
+    return os << atom.str();
+}
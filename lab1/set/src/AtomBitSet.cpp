@@ -0,0 +1,200 @@
+#include "AtomBitSet.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+std::uint32_t AtomDictionary::intern(const std::string& atom) {
+    auto inserted = ids_.emplace(atom, static_cast<std::uint32_t>(atoms_.size()));
+    if (inserted.second) {
+        atoms_.push_back(&inserted.first->first);
+    }
+    return inserted.first->second;
+}
+
+std::uint32_t AtomDictionary::find(const std::string& atom) const {
+    auto it = ids_.find(atom);
+    return it == ids_.end() ? NOT_FOUND : it->second;
+}
+
+const std::string& AtomDictionary::atom(std::uint32_t id) const {
+    if (id >= atoms_.size()) {
+        throw std::out_of_range("Unknown atom id");
+    }
+    return *atoms_[id];
+}
+
+std::size_t AtomDictionary::size() const {
+    return atoms_.size();
+}
+
+AtomBitSet::AtomBitSet(std::shared_ptr<AtomDictionary> dictionary)
+    : dictionary_(std::move(dictionary)) {
+    if (!dictionary_) {
+        throw std::invalid_argument("AtomBitSet requires a dictionary");
+    }
+}
+
+AtomBitSet AtomBitSet::fromSet(const Set& set, std::shared_ptr<AtomDictionary> dictionary) {
+    AtomBitSet result(std::move(dictionary));
+    for (const auto& element : set) {
+        result.insert(element);
+    }
+    return result;
+}
+
+Set AtomBitSet::toSet() const {
+    return Set(elements());
+}
+
+std::vector<Set::Element> AtomBitSet::elements() const {
+    std::vector<Set::Element> result;
+    result.reserve(size());
+    for (std::size_t w = 0; w < words_.size(); ++w) {
+        std::uint64_t word = words_[w];
+        while (word != 0) {
+            std::uint32_t bit = static_cast<std::uint32_t>(__builtin_ctzll(word));
+            result.emplace_back(dictionary_->atom(static_cast<std::uint32_t>(w * 64 + bit)));
+            word &= word - 1;
+        }
+    }
+    return result;
+}
+
+bool AtomBitSet::contains(const Set::Element& item) const {
+    return item.type == Set::VALUE && contains(item.atom.str());
+}
+
+bool AtomBitSet::contains(const std::string& atom) const {
+    std::uint32_t id = dictionary_->find(atom);
+    return id != AtomDictionary::NOT_FOUND && testBit(id);
+}
+
+bool AtomBitSet::isEmpty() const {
+    for (std::uint64_t word : words_) {
+        if (word != 0) return false;
+    }
+    return true;
+}
+
+std::size_t AtomBitSet::size() const {
+    std::size_t count = 0;
+    for (std::uint64_t word : words_) {
+        count += static_cast<std::size_t>(__builtin_popcountll(word));
+    }
+    return count;
+}
+
+void AtomBitSet::insert(const Set::Element& item) {
+    insert(requireAtom(item));
+}
+
+void AtomBitSet::insert(const std::string& atom) {
+    std::uint32_t id = dictionary_->intern(atom);
+    if (id / 64 >= words_.size()) {
+        words_.resize(id / 64 + 1, 0);
+    }
+    words_[id / 64] |= std::uint64_t(1) << (id % 64);
+}
+
+void AtomBitSet::erase(const Set::Element& item) {
+    if (item.type == Set::VALUE) erase(item.atom.str());
+}
+
+void AtomBitSet::erase(const std::string& atom) {
+    std::uint32_t id = dictionary_->find(atom);
+    if (id != AtomDictionary::NOT_FOUND && id / 64 < words_.size()) {
+        words_[id / 64] &= ~(std::uint64_t(1) << (id % 64));
+    }
+}
+
+AtomBitSet AtomBitSet::unite(const AtomBitSet& other) const {
+    AtomBitSet result(*this);
+    result.selfUnite(other);
+    return result;
+}
+
+AtomBitSet& AtomBitSet::selfUnite(const AtomBitSet& other) {
+    checkDictionary(other);
+    if (other.words_.size() > words_.size()) {
+        words_.resize(other.words_.size(), 0);
+    }
+    std::uint64_t* dst = words_.data();
+    const std::uint64_t* src = other.words_.data();
+    for (std::size_t i = 0, n = other.words_.size(); i < n; ++i) {
+        dst[i] |= src[i];
+    }
+    return *this;
+}
+
+AtomBitSet AtomBitSet::intersect(const AtomBitSet& other) const {
+    AtomBitSet result(*this);
+    result.selfIntersect(other);
+    return result;
+}
+
+AtomBitSet& AtomBitSet::selfIntersect(const AtomBitSet& other) {
+    checkDictionary(other);
+    if (words_.size() > other.words_.size()) {
+        words_.resize(other.words_.size());
+    }
+    std::uint64_t* dst = words_.data();
+    const std::uint64_t* src = other.words_.data();
+    for (std::size_t i = 0, n = words_.size(); i < n; ++i) {
+        dst[i] &= src[i];
+    }
+    return *this;
+}
+
+AtomBitSet AtomBitSet::difference(const AtomBitSet& other) const {
+    AtomBitSet result(*this);
+    result.selfDifference(other);
+    return result;
+}
+
+AtomBitSet& AtomBitSet::selfDifference(const AtomBitSet& other) {
+    checkDictionary(other);
+    std::uint64_t* dst = words_.data();
+    const std::uint64_t* src = other.words_.data();
+    for (std::size_t i = 0, n = std::min(words_.size(), other.words_.size()); i < n; ++i) {
+        dst[i] &= ~src[i];
+    }
+    return *this;
+}
+
+bool AtomBitSet::operator==(const AtomBitSet& other) const {
+    if (dictionary_ != other.dictionary_) return false;
+    const std::vector<std::uint64_t>& shorter = words_.size() < other.words_.size() ? words_ : other.words_;
+    const std::vector<std::uint64_t>& longer = words_.size() < other.words_.size() ? other.words_ : words_;
+    for (std::size_t i = 0; i < shorter.size(); ++i) {
+        if (shorter[i] != longer[i]) return false;
+    }
+    for (std::size_t i = shorter.size(); i < longer.size(); ++i) {
+        if (longer[i] != 0) return false;
+    }
+    return true;
+}
+
+bool AtomBitSet::operator!=(const AtomBitSet& other) const {
+    return !(*this == other);
+}
+
+const std::shared_ptr<AtomDictionary>& AtomBitSet::dictionary() const {
+    return dictionary_;
+}
+
+void AtomBitSet::checkDictionary(const AtomBitSet& other) const {
+    if (dictionary_ != other.dictionary_) {
+        throw std::invalid_argument("AtomBitSet operands use different dictionaries");
+    }
+}
+
+bool AtomBitSet::testBit(std::uint32_t id) const {
+    return id / 64 < words_.size() && (words_[id / 64] >> (id % 64)) & 1;
+}
+
+const std::string& AtomBitSet::requireAtom(const Set::Element& item) {
+    if (item.type != Set::VALUE) {
+        throw std::invalid_argument("AtomBitSet holds atoms only");
+    }
+    return item.atom.str();
+}
@@ -0,0 +1,189 @@
+#include "BinaryFormat.h"
+#include <stdexcept>
+#include <utility>
+
+void BinaryWriter::writeByte(std::uint8_t value) {
+    buffer_ += static_cast<char>(value);
+}
+
+void BinaryWriter::writeVarint(std::uint64_t value) {
+    while (value >= 0x80) {
+        buffer_ += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    buffer_ += static_cast<char>(value);
+}
+
+void BinaryWriter::writeFixed64(std::uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        buffer_ += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void BinaryWriter::writeBytes(std::string_view bytes) {
+    buffer_.append(bytes.data(), bytes.size());
+}
+
+const std::string& BinaryWriter::buffer() const {
+    return buffer_;
+}
+
+std::string BinaryWriter::take() {
+    return std::move(buffer_);
+}
+
+BinaryReader::BinaryReader(std::string_view data) : data_(data), pos_(0) {}
+
+std::uint8_t BinaryReader::readByte() {
+    if (pos_ >= data_.size()) {
+        throw std::invalid_argument("Truncated binary set");
+    }
+    return static_cast<std::uint8_t>(data_[pos_++]);
+}
+
+std::uint64_t BinaryReader::readVarint() {
+    std::uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        std::uint8_t byte = readByte();
+        value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return value;
+    }
+    throw std::invalid_argument("Malformed varint");
+}
+
+std::uint64_t BinaryReader::readFixed64() {
+    std::string_view bytes = readBytes(8);
+    std::uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(bytes[i])) << (8 * i);
+    }
+    return value;
+}
+
+std::string_view BinaryReader::readBytes(std::size_t count) {
+    if (count > remaining()) {
+        throw std::invalid_argument("Truncated binary set");
+    }
+    std::string_view bytes = data_.substr(pos_, count);
+    pos_ += count;
+    return bytes;
+}
+
+std::size_t BinaryReader::position() const {
+    return pos_;
+}
+
+std::size_t BinaryReader::remaining() const {
+    return data_.size() - pos_;
+}
+
+bool BinaryReader::atEnd() const {
+    return pos_ == data_.size();
+}
+
+// Обход деревьев элементов здесь — явным стеком: глубина вложенности,
+// как и при текстовом разборе, не ограничена стеком вызовов
+void ElementEncoder::collect(const Set::Element& element) {
+    std::vector<const Set::Element*> pending{&element};
+    while (!pending.empty()) {
+        const Set::Element& current = *pending.back();
+        pending.pop_back();
+        if (current.type == Set::VALUE) {
+            auto inserted = atomIndex_.emplace(current.atom.id(), atoms_.size());
+            if (inserted.second) {
+                atoms_.push_back(current.atom);
+            }
+            continue;
+        }
+        for (const auto& child : current.subset) {
+            pending.push_back(&child);
+        }
+    }
+}
+
+void ElementEncoder::writeAtomTable(BinaryWriter& out) const {
+    out.writeVarint(atoms_.size());
+    for (const Atom& atom : atoms_) {
+        out.writeVarint(atom.size());
+        out.writeBytes(atom.str());
+    }
+}
+
+void ElementEncoder::writeElement(BinaryWriter& out, const Set::Element& element) const {
+    // Дети кладутся в стек в обратном порядке, чтобы выйти в прямом
+    std::vector<const Set::Element*> pending{&element};
+    while (!pending.empty()) {
+        const Set::Element& current = *pending.back();
+        pending.pop_back();
+        if (current.type == Set::VALUE) {
+            out.writeVarint(atomIndex_.at(current.atom.id()) << 1);
+            continue;
+        }
+        out.writeVarint((static_cast<std::uint64_t>(current.subset.size()) << 1) | 1);
+        for (auto it = current.subset.end(); it != current.subset.begin();) {
+            pending.push_back(--it);
+        }
+    }
+}
+
+void ElementDecoder::readAtomTable(BinaryReader& in) {
+    std::uint64_t count = in.readVarint();
+    // Каждая строка таблицы занимает хотя бы байт длины
+    if (count > in.remaining()) {
+        throw std::invalid_argument("Truncated binary set");
+    }
+    atoms_.clear();
+    atoms_.reserve(count);
+    for (std::uint64_t i = 0; i < count; ++i) {
+        atoms_.emplace_back(in.readBytes(in.readVarint()));
+    }
+}
+
+Set::Element ElementDecoder::readElement(BinaryReader& in) const {
+    // Открытые вложенные множества: собранные дети и сколько ещё ждать
+    struct Frame {
+        std::vector<Set::Element> children;
+        std::uint64_t expected;
+    };
+    std::vector<Frame> open;
+    while (true) {
+        std::uint64_t tag = in.readVarint();
+        Set::Element element;
+        if ((tag & 1) == 0) {
+            std::uint64_t index = tag >> 1;
+            if (index >= atoms_.size()) {
+                throw std::invalid_argument("Atom index out of range");
+            }
+            element = Set::Element(atoms_[index]);
+        } else {
+            std::uint64_t count = tag >> 1;
+            if (count > in.remaining()) {
+                throw std::invalid_argument("Truncated binary set");
+            }
+            if (count > 0) {
+                open.push_back(Frame{{}, count});
+                open.back().children.reserve(count);
+                continue;
+            }
+            element = Set::Element(std::vector<Set::Element>());
+        }
+        // Готовый элемент закрывает все заполнившиеся уровни
+        while (!open.empty()) {
+            Frame& frame = open.back();
+            frame.children.push_back(std::move(element));
+            if (frame.children.size() < frame.expected) break;
+            element = Set::Element(std::move(frame.children));
+            open.pop_back();
+        }
+        if (open.empty()) return element;
+    }
+}
+
+std::uint64_t fnv1a64(std::string_view data) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (char c : data) {
+        hash ^= static_cast<std::uint8_t>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
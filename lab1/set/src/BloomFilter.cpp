@@ -0,0 +1,59 @@
+#include "BloomFilter.h"
+#include <cmath>
+
+BloomFilter::BloomFilter(std::size_t capacity)
+    : mask_(0), capacity_(capacity == 0 ? 1 : capacity), entries_(0), removed_(0) {
+    std::size_t bits = 64;
+    while (bits < capacity_ * BITS_PER_ENTRY) bits <<= 1;
+    words_.assign(bits / 64, 0);
+    mask_ = bits - 1;
+}
+
+// Двойное хеширование: пробы h1 + i·h2, шаг нечётный и не вырождается
+void BloomFilter::add(std::uint64_t hash) {
+    const std::uint64_t step = (hash >> 32) | 1;
+    for (unsigned i = 0; i < HASHES; ++i, hash += step) {
+        const std::size_t bit = static_cast<std::size_t>(hash) & mask_;
+        words_[bit >> 6] |= std::uint64_t(1) << (bit & 63);
+    }
+    ++entries_;
+}
+
+bool BloomFilter::mayContain(std::uint64_t hash) const {
+    const std::uint64_t step = (hash >> 32) | 1;
+    for (unsigned i = 0; i < HASHES; ++i, hash += step) {
+        const std::size_t bit = static_cast<std::size_t>(hash) & mask_;
+        if ((words_[bit >> 6] & (std::uint64_t(1) << (bit & 63))) == 0) return false;
+    }
+    return true;
+}
+
+void BloomFilter::noteRemoved(std::size_t count) {
+    removed_ += count;
+}
+
+std::size_t BloomFilter::capacity() const {
+    return capacity_;
+}
+
+std::size_t BloomFilter::entries() const {
+    return entries_;
+}
+
+std::size_t BloomFilter::removed() const {
+    return removed_;
+}
+
+std::size_t BloomFilter::bits() const {
+    return mask_ + 1;
+}
+
+std::size_t BloomFilter::memoryUsage() const {
+    return sizeof(BloomFilter) + words_.capacity() * sizeof(std::uint64_t);
+}
+
+double BloomFilter::falsePositiveRate() const {
+    const double fill = 1.0 - std::exp(-static_cast<double>(HASHES) * static_cast<double>(entries_) /
+                                       static_cast<double>(bits()));
+    return std::pow(fill, static_cast<double>(HASHES));
+}
@@ -0,0 +1,34 @@
+#include "ElementIndex.h"
+
+ElementIndex::ElementIndex() = default;
+
+ElementIndex::ElementIndex(const Set& set) {
+    elements_.reserve(set.size());
+    for (const auto& element : set) {
+        elements_.insert(&element);
+    }
+}
+
+bool ElementIndex::insert(const Set::Element& element) {
+    return elements_.insert(&element).second;
+}
+
+bool ElementIndex::contains(const Set::Element& element) const {
+    return elements_.find(&element) != elements_.end();
+}
+
+std::size_t ElementIndex::size() const {
+    return elements_.size();
+}
+
+void ElementIndex::reserve(std::size_t count) {
+    elements_.reserve(count);
+}
+
+std::size_t ElementIndex::PointerHash::operator()(const Set::Element* element) const {
+    return Set::ElementHash()(*element);
+}
+
+bool ElementIndex::PointerEqual::operator()(const Set::Element* lhs, const Set::Element* rhs) const {
+    return *lhs == *rhs;
+}
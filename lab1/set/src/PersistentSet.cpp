@@ -0,0 +1,290 @@
+#include "PersistentSet.h"
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr unsigned BITS = 5;
+constexpr std::uint32_t MASK = (1u << BITS) - 1;
+// После исчерпания 64 бит хеша узел хранит коллизии списком
+constexpr unsigned HASH_BITS = 64;
+
+std::uint32_t branchBit(std::uint64_t hash, unsigned shift) {
+    return 1u << ((hash >> shift) & MASK);
+}
+
+std::size_t branchIndex(std::uint32_t bitmap, std::uint32_t bit) {
+    return static_cast<std::size_t>(__builtin_popcount(bitmap & (bit - 1)));
+}
+
+std::uint64_t hashOf(const Set::Element& element) {
+    return static_cast<std::uint64_t>(Set::ElementHash()(element));
+}
+
+}
+
+// Запись узла — либо элемент со своим хешем, либо ссылка на поддерево
+struct PersistentSet::Node {
+    struct Entry {
+        std::uint64_t hash;
+        Set::Element element;
+        NodePtr child;
+    };
+
+    std::uint32_t bitmap = 0;
+    bool collision = false;
+    std::size_t size = 0;
+    std::vector<Entry> entries;
+
+    static NodePtr single(Entry entry, unsigned shift);
+    static NodePtr pair(Entry first, Entry second, unsigned shift);
+
+    bool contains(std::uint64_t hash, const Set::Element& item, unsigned shift) const;
+    // Возвращает nullptr, если элемент уже есть
+    NodePtr insert(std::uint64_t hash, const Set::Element& item, unsigned shift) const;
+    // removed остаётся false, если элемента нет; nullptr — узел опустел
+    NodePtr erase(std::uint64_t hash, const Set::Element& item, unsigned shift, bool& removed) const;
+    void forEach(const std::function<void(const Set::Element&)>& visitor) const;
+};
+
+PersistentSet::NodePtr PersistentSet::Node::single(Entry entry, unsigned shift) {
+    auto node = std::make_shared<Node>();
+    node->collision = shift >= HASH_BITS;
+    node->bitmap = node->collision ? 0 : branchBit(entry.hash, shift);
+    node->size = 1;
+    node->entries.push_back(std::move(entry));
+    return node;
+}
+
+PersistentSet::NodePtr PersistentSet::Node::pair(Entry first, Entry second, unsigned shift) {
+    auto node = std::make_shared<Node>();
+    node->size = 2;
+    if (shift >= HASH_BITS) {
+        node->collision = true;
+        node->entries.push_back(std::move(first));
+        node->entries.push_back(std::move(second));
+        return node;
+    }
+    const std::uint32_t firstBit = branchBit(first.hash, shift);
+    const std::uint32_t secondBit = branchBit(second.hash, shift);
+    if (firstBit == secondBit) {
+        node->bitmap = firstBit;
+        Entry nested{first.hash, Set::Element(), pair(std::move(first), std::move(second), shift + BITS)};
+        node->entries.push_back(std::move(nested));
+        return node;
+    }
+    node->bitmap = firstBit | secondBit;
+    if (firstBit < secondBit) {
+        node->entries.push_back(std::move(first));
+        node->entries.push_back(std::move(second));
+    } else {
+        node->entries.push_back(std::move(second));
+        node->entries.push_back(std::move(first));
+    }
+    return node;
+}
+
+bool PersistentSet::Node::contains(std::uint64_t hash, const Set::Element& item, unsigned shift) const {
+    const Node* node = this;
+    while (true) {
+        if (node->collision) {
+            for (const auto& entry : node->entries) {
+                if (entry.element == item) return true;
+            }
+            return false;
+        }
+        const std::uint32_t bit = branchBit(hash, shift);
+        if ((node->bitmap & bit) == 0) return false;
+        const Entry& entry = node->entries[branchIndex(node->bitmap, bit)];
+        if (!entry.child) {
+            return entry.hash == hash && entry.element == item;
+        }
+        node = entry.child.get();
+        shift += BITS;
+    }
+}
+
+PersistentSet::NodePtr PersistentSet::Node::insert(std::uint64_t hash, const Set::Element& item, unsigned shift) const {
+    if (collision) {
+        for (const auto& entry : entries) {
+            if (entry.element == item) return nullptr;
+        }
+        auto copy = std::make_shared<Node>(*this);
+        copy->entries.push_back(Entry{hash, item, nullptr});
+        ++copy->size;
+        return copy;
+    }
+    const std::uint32_t bit = branchBit(hash, shift);
+    const std::size_t index = branchIndex(bitmap, bit);
+    if ((bitmap & bit) == 0) {
+        auto copy = std::make_shared<Node>(*this);
+        copy->bitmap |= bit;
+        copy->entries.insert(copy->entries.begin() + static_cast<std::ptrdiff_t>(index), Entry{hash, item, nullptr});
+        ++copy->size;
+        return copy;
+    }
+    const Entry& entry = entries[index];
+    NodePtr child;
+    if (entry.child) {
+        child = entry.child->insert(hash, item, shift + BITS);
+        if (!child) return nullptr;
+    } else {
+        if (entry.hash == hash && entry.element == item) return nullptr;
+        child = pair(entry, Entry{hash, item, nullptr}, shift + BITS);
+    }
+    auto copy = std::make_shared<Node>(*this);
+    copy->entries[index] = Entry{hash, Set::Element(), std::move(child)};
+    ++copy->size;
+    return copy;
+}
+
+PersistentSet::NodePtr PersistentSet::Node::erase(std::uint64_t hash, const Set::Element& item, unsigned shift,
+                                                  bool& removed) const {
+    std::size_t index = 0;
+    Entry replacement;
+    bool replace = false;
+    if (collision) {
+        while (index < entries.size() && !(entries[index].element == item)) ++index;
+        if (index == entries.size()) return nullptr;
+    } else {
+        const std::uint32_t bit = branchBit(hash, shift);
+        if ((bitmap & bit) == 0) return nullptr;
+        index = branchIndex(bitmap, bit);
+        const Entry& entry = entries[index];
+        if (entry.child) {
+            bool childRemoved = false;
+            NodePtr child = entry.child->erase(hash, item, shift + BITS, childRemoved);
+            if (!childRemoved) return nullptr;
+            if (child) {
+                replace = true;
+                // Поддерево из одного элемента сворачивается в запись
+                if (child->entries.size() == 1 && !child->entries.front().child) {
+                    replacement = child->entries.front();
+                } else {
+                    replacement = Entry{hash, Set::Element(), std::move(child)};
+                }
+            }
+        } else if (entry.hash != hash || !(entry.element == item)) {
+            return nullptr;
+        }
+    }
+    removed = true;
+    if (!replace && entries.size() == 1) return nullptr;
+    auto copy = std::make_shared<Node>(*this);
+    --copy->size;
+    if (replace) {
+        copy->entries[index] = std::move(replacement);
+    } else {
+        copy->entries.erase(copy->entries.begin() + static_cast<std::ptrdiff_t>(index));
+        if (!collision) copy->bitmap &= ~branchBit(hash, shift);
+    }
+    return copy;
+}
+
+void PersistentSet::Node::forEach(const std::function<void(const Set::Element&)>& visitor) const {
+    for (const auto& entry : entries) {
+        if (entry.child) {
+            entry.child->forEach(visitor);
+        } else {
+            visitor(entry.element);
+        }
+    }
+}
+
+PersistentSet::PersistentSet() = default;
+
+PersistentSet::PersistentSet(NodePtr root) : root_(std::move(root)) {}
+
+PersistentSet::PersistentSet(const Set& set) {
+    PersistentSet result;
+    for (const auto& element : set) {
+        result = result.insert(element);
+    }
+    root_ = std::move(result.root_);
+}
+
+bool PersistentSet::contains(const Set::Element& item) const {
+    return root_ && root_->contains(hashOf(item), item, 0);
+}
+
+bool PersistentSet::isEmpty() const {
+    return !root_;
+}
+
+std::size_t PersistentSet::size() const {
+    return root_ ? root_->size : 0;
+}
+
+PersistentSet PersistentSet::insert(const Set::Element& item) const {
+    const std::uint64_t hash = hashOf(item);
+    if (!root_) {
+        return PersistentSet(Node::single(Node::Entry{hash, item, nullptr}, 0));
+    }
+    NodePtr root = root_->insert(hash, item, 0);
+    return root ? PersistentSet(std::move(root)) : *this;
+}
+
+PersistentSet PersistentSet::erase(const Set::Element& item) const {
+    if (!root_) return *this;
+    bool removed = false;
+    NodePtr root = root_->erase(hashOf(item), item, 0, removed);
+    return removed ? PersistentSet(std::move(root)) : *this;
+}
+
+void PersistentSet::forEach(const std::function<void(const Set::Element&)>& visitor) const {
+    if (root_) root_->forEach(visitor);
+}
+
+Set PersistentSet::toSet() const {
+    // Элементы уже уникальны, поэтому пишутся в хранилище напрямую
+    Set result;
+    result.storage_.reserve(size());
+    forEach([&result](const Set::Element& element) { result.storage_.push_back(element); });
+    return result;
+}
+
+bool PersistentSet::operator==(const PersistentSet& other) const {
+    if (root_ == other.root_) return true;
+    if (size() != other.size()) return false;
+    bool equal = true;
+    forEach([&](const Set::Element& element) {
+        if (equal && !other.contains(element)) equal = false;
+    });
+    return equal;
+}
+
+bool PersistentSet::operator!=(const PersistentSet& other) const {
+    return !(*this == other);
+}
+
+bool PersistentSet::sharesRootWith(const PersistentSet& other) const {
+    return root_ == other.root_;
+}
+
+VersionedSet::VersionedSet() : VersionedSet(PersistentSet()) {}
+
+VersionedSet::VersionedSet(PersistentSet initial)
+    : current_(std::make_shared<const PersistentSet>(std::move(initial))), version_(0) {}
+
+PersistentSet VersionedSet::snapshot() const {
+    return *std::atomic_load_explicit(&current_, std::memory_order_acquire);
+}
+
+std::uint64_t VersionedSet::version() const {
+    return version_.load(std::memory_order_acquire);
+}
+
+void VersionedSet::publish(PersistentSet next) {
+    std::lock_guard<std::mutex> lock(writer_);
+    std::atomic_store_explicit(&current_, std::make_shared<const PersistentSet>(std::move(next)),
+                               std::memory_order_release);
+    version_.fetch_add(1, std::memory_order_acq_rel);
+}
+
+PersistentSet VersionedSet::update(const std::function<PersistentSet(const PersistentSet&)>& change) {
+    std::lock_guard<std::mutex> lock(writer_);
+    PersistentSet next = change(*std::atomic_load_explicit(&current_, std::memory_order_acquire));
+    std::atomic_store_explicit(&current_, std::make_shared<const PersistentSet>(next), std::memory_order_release);
+    version_.fetch_add(1, std::memory_order_acq_rel);
+    return next;
+}
@@ -1,19 +1,440 @@
 #include "Set.h"
+#include "BloomFilter.h"
+#include "ElementIndex.h"
+#include "SetStats.h"
+#include "StructuralScanner.h"
 #include <stdexcept>
 #include <cctype>
 #include <algorithm>
+#include <atomic>
+#include <map>
+#include <new>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+struct Set::Subset::Node {
+    std::atomic<std::uint32_t> refs;
+    std::uint32_t size;
+    std::pmr::memory_resource* resource;
+    // Отпечаток содержимого (ElementHash), 0 — ещё не вычислен
+    std::atomic<std::uint64_t> hash;
+    // Хранилище, где узел канонический; пока оно живо, узел неизменен
+    std::atomic<const SubsetStore*> store;
+
+    Element* children() {
+        return reinterpret_cast<Element*>(this + 1);
+    }
+
+    static std::size_t bytes(std::size_t count) {
+        return sizeof(Node) + count * sizeof(Element);
+    }
+};
+
+// Пары (отпечаток, позиция в storage_), отсортированные по отпечатку
+struct Set::FingerprintIndex {
+    std::vector<std::pair<std::uint64_t, std::size_t>> entries;
+};
+
+static_assert(sizeof(Set::Element) <= 16, "Element must stay a compact handle");
+
+namespace {
+
+// Учёт копирований для SetStats; выделения памяти считает заменённый
+// operator new. Без SET_ENABLE_STATS тело пусто и вызов исчезает
+void countCopy([[maybe_unused]] std::size_t count) {
+    SET_STATS_COUNT(bytesCopied, count * sizeof(Set::Element));
+}
+
+std::uint64_t mixHash(std::uint64_t value) {
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+// Хеш множества по хешам элементов: сортировка убирает зависимость от
+// порядка, удаление повторов — от дубликатов. Короткие списки
+// сортируются на стеке. 0 зарезервирован под «не вычислен» в кешах.
+template <class Iterator>
+std::uint64_t combineHashes(Iterator first, Iterator last) {
+    const std::size_t size = static_cast<std::size_t>(last - first);
+    std::uint64_t local[16];
+    std::vector<std::uint64_t> heap;
+    std::uint64_t* hashes = local;
+    if (size > 16) {
+        heap.resize(size);
+        hashes = heap.data();
+    }
+    std::size_t count = 0;
+    for (; first != last; ++first) {
+        hashes[count++] = Set::ElementHash()(*first);
+    }
+    std::sort(hashes, hashes + count);
+    count = static_cast<std::size_t>(std::unique(hashes, hashes + count) - hashes);
+    std::uint64_t hash = mixHash(~std::uint64_t(0));
+    for (std::size_t i = 0; i < count; ++i) {
+        hash = mixHash(hash ^ hashes[i]);
+    }
+    return hash == 0 ? 1 : hash;
+}
+
+}
+
+Set::Subset::Subset() : node_(nullptr) {}
+
+Set::Subset::Subset(const std::vector<Element>& items) : Subset(std::vector<Element>(items)) {}
+
+Set::Subset::Subset(std::vector<Element>&& items) : Subset(items, 0) {}
+
+Set::Subset::Subset(std::vector<Element>& items, std::size_t from, std::pmr::memory_resource* resource)
+    : node_(nullptr) {
+    if (from >= items.size()) return;
+    adopt(items.data() + from, items.size() - from, true, resource);
+    items.resize(from);
+}
+
+Set::Subset::Subset(const Subset& other) : node_(other.node_) {
+    if (node_ != nullptr) node_->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+Set::Subset::Subset(Subset&& other) noexcept : node_(std::exchange(other.node_, nullptr)) {}
+
+Set::Subset::Subset(const Subset& other, std::pmr::memory_resource* resource) : node_(nullptr) {
+    if (other.node_ == nullptr) return;
+    if (other.node_->resource == resource) {
+        node_ = other.node_;
+        node_->refs.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    adopt(other.node_->children(), other.node_->size, false, resource);
+}
+
+Set::Subset::Subset(Subset&& other, std::pmr::memory_resource* resource) : node_(nullptr) {
+    if (other.node_ == nullptr) return;
+    if (other.node_->resource == resource) {
+        node_ = std::exchange(other.node_, nullptr);
+        return;
+    }
+    // Узел из чужого ресурса может быть разделён, поэтому дети копируются
+    adopt(other.node_->children(), other.node_->size, false, resource);
+    other.release();
+}
+
+void Set::Subset::adopt(Element* items, std::size_t count, bool move, std::pmr::memory_resource* resource) {
+    // Дети получают аллокатор узла, так что всё поддерево оказывается в
+    // одном ресурсе. Узлы из чужого ресурса клонируются без рекурсии:
+    // ребёнок сначала остаётся пустым, а пара (место, источник) ждёт в
+    // стеке. Недостроенное дерево всегда корректно, поэтому при исключении
+    // достаточно освободить корень.
+    if (count > UINT32_MAX) {
+        throw std::length_error("Nested set is too large");
+    }
+    std::vector<std::pair<Subset*, Subset>> pending;
+    Subset* target = this;
+    Subset source;
+    Element* from = items;
+    bool steal = move;
+    try {
+        while (true) {
+            void* memory = resource->allocate(Node::bytes(count), alignof(Node));
+            if (!steal) SET_STATS_COUNT(bytesCopied, count * sizeof(Element));
+            Node* node = new (memory) Node();
+            node->refs.store(1, std::memory_order_relaxed);
+            node->size = 0;
+            node->hash.store(0, std::memory_order_relaxed);
+            node->store.store(nullptr, std::memory_order_relaxed);
+            node->resource = resource;
+            target->node_ = node;
+            Element* children = node->children();
+            for (std::size_t i = 0; i < count; ++i) {
+                Element* child = new (children + i) Element();
+                ++node->size;
+                child->type = from[i].type;
+                child->atom = from[i].atom;
+                Subset& nested = from[i].subset;
+                if (nested.node_ == nullptr) continue;
+                if (nested.node_->resource == resource) {
+                    if (steal) {
+                        child->subset = std::move(nested);
+                    } else {
+                        child->subset = nested;
+                    }
+                } else if (steal) {
+                    pending.emplace_back(&child->subset, std::move(nested));
+                } else {
+                    pending.emplace_back(&child->subset, nested);
+                }
+            }
+            if (pending.empty()) return;
+            // Источник удерживается, пока из него копируются дети
+            target = pending.back().first;
+            source = std::move(pending.back().second);
+            pending.pop_back();
+            from = source.node_->children();
+            count = source.node_->size;
+            steal = false;
+        }
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+Set::Subset& Set::Subset::operator=(const Subset& other) {
+    if (node_ != other.node_) {
+        Subset copy(other);
+        std::swap(node_, copy.node_);
+    }
+    return *this;
+}
+
+Set::Subset& Set::Subset::operator=(Subset&& other) noexcept {
+    if (this != &other) {
+        release();
+        node_ = std::exchange(other.node_, nullptr);
+    }
+    return *this;
+}
+
+Set::Subset::~Subset() {
+    release();
+}
+
+void Set::Subset::release() {
+    if (node_ == nullptr) return;
+    Node* node = std::exchange(node_, nullptr);
+    if (node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    // Освободившиеся вложенные узлы собираются в список, а не удаляются
+    // рекурсивно: глубина дерева не ограничена стеком вызовов
+    std::vector<Node*> pending;
+    while (true) {
+        Element* children = node->children();
+        for (std::uint32_t i = 0; i < node->size; ++i) {
+            Node* child = std::exchange(children[i].subset.node_, nullptr);
+            if (child != nullptr && child->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                pending.push_back(child);
+            }
+            children[i].~Element();
+        }
+        std::pmr::memory_resource* resource = node->resource;
+        const std::size_t bytes = Node::bytes(node->size);
+        node->~Node();
+        resource->deallocate(node, bytes, alignof(Node));
+        if (pending.empty()) return;
+        node = pending.back();
+        pending.pop_back();
+    }
+}
+
+std::size_t Set::Subset::size() const {
+    return node_ == nullptr ? 0 : node_->size;
+}
+
+bool Set::Subset::empty() const {
+    return node_ == nullptr;
+}
+
+const SubsetStore* Set::Subset::store() const {
+    return node_ == nullptr ? nullptr : node_->store.load(std::memory_order_relaxed);
+}
+
+void Set::Subset::setStore(const SubsetStore* store) const {
+    node_->store.store(store, std::memory_order_relaxed);
+}
+
+Set::Subset::const_iterator Set::Subset::begin() const {
+    return node_ == nullptr ? nullptr : node_->children();
+}
+
+Set::Subset::const_iterator Set::Subset::end() const {
+    return node_ == nullptr ? nullptr : node_->children() + node_->size;
+}
+
+const Set::Element& Set::Subset::operator[](std::size_t index) const {
+    return node_->children()[index];
+}
+
+std::vector<Set::Element> Set::Subset::toVector() const {
+    return std::vector<Element>(begin(), end());
+}
+
+bool Set::Subset::sharesNodeWith(const Subset& other) const {
+    return node_ == other.node_;
+}
+
+std::pmr::memory_resource* Set::Subset::resource() const {
+    return node_ == nullptr ? nullptr : node_->resource;
+}
+
+std::uint64_t Set::Subset::fingerprint() const {
+    if (node_ == nullptr) {
+        static const std::uint64_t empty = combineHashes(begin(), end());
+        return empty;
+    }
+    const std::uint64_t cached = node_->hash.load(std::memory_order_relaxed);
+    if (cached != 0) return cached;
+    // Снизу вверх с явным стеком: узел считается, когда у всех вложенных
+    // детей отпечатки уже есть. Параллельные вычисления дают одно значение.
+    std::vector<Node*> pending{node_};
+    while (!pending.empty()) {
+        Node* node = pending.back();
+        bool ready = true;
+        for (std::uint32_t i = 0; i < node->size; ++i) {
+            Node* child = node->children()[i].subset.node_;
+            if (child != nullptr && child->hash.load(std::memory_order_relaxed) == 0) {
+                pending.push_back(child);
+                ready = false;
+            }
+        }
+        if (!ready) continue;
+        pending.pop_back();
+        if (node->hash.load(std::memory_order_relaxed) != 0) continue;
+        node->hash.store(combineHashes(node->children(), node->children() + node->size),
+                         std::memory_order_relaxed);
+    }
+    return node_->hash.load(std::memory_order_relaxed);
+}
 
 Set::Element::Element() : type(VALUE) {}
+
+Set::Element::Element(const allocator_type&) : type(VALUE) {}
+
+Set::Element::Element(const Element& other, const allocator_type& allocator)
+    : type(other.type), atom(other.atom), subset(other.subset, allocator.resource()) {}
+
+Set::Element::Element(Element&& other, const allocator_type& allocator)
+    : type(other.type), atom(other.atom), subset(std::move(other.subset), allocator.resource()) {}
+
+Set::Element::Element(const char* value) : type(VALUE), atom(value) {}
 Set::Element::Element(const std::string& value) : type(VALUE), atom(value) {}
+Set::Element::Element(Atom value) : type(VALUE), atom(value) {}
 Set::Element::Element(const std::vector<Element>& nested) : type(NESTED_SET), subset(nested) {}
+Set::Element::Element(std::vector<Element>&& nested) : type(NESTED_SET), subset(std::move(nested)) {}
+Set::Element::Element(Subset nested) : type(NESTED_SET), subset(std::move(nested)) {}
+
+namespace {
+
+// Равенство вложенных множеств без рекурсии: глубина дерева, как при
+// разборе и сериализации, не ограничена стеком вызовов. Узел опознаётся
+// по адресу массива детей (nullptr — пустое множество).
+using NodeKey = const Set::Element*;
+
+// Стек, первые Inline записей которого лежат в самом объекте: пока он
+// не переполнен, обход не обращается к куче
+template <class T, std::size_t Inline>
+class ScratchStack {
+public:
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    void push(const T& value) {
+        if (size_ < Inline) {
+            local_[size_] = value;
+        } else {
+            spill_.push_back(value);
+        }
+        ++size_;
+    }
+
+    T pop() {
+        --size_;
+        if (size_ < Inline) return local_[size_];
+        T value = spill_.back();
+        spill_.pop_back();
+        return value;
+    }
+
+private:
+    T local_[Inline];
+    std::vector<T> spill_;
+    std::size_t size_ = 0;
+};
+
+// Частый случай — те же дети в том же порядке на всех уровнях. Обход
+// обоих деревьев параллельно; false означает лишь «порядок отличается».
+// Ожидающие пары узлов лежат в ScratchStack, так что совпадение без
+// глубоких и широких поддеревьев памяти не выделяет.
+bool sameLayout(const Set::Subset& lhs, const Set::Subset& rhs) {
+    using Pair = std::pair<const Set::Subset*, const Set::Subset*>;
+    ScratchStack<Pair, 32> pending;
+    pending.push(Pair(&lhs, &rhs));
+    while (!pending.empty()) {
+        const Pair top = pending.pop();
+        const Set::Subset& left = *top.first;
+        const Set::Subset& right = *top.second;
+        if (left.size() != right.size()) return false;
+        for (std::size_t i = 0; i < left.size(); ++i) {
+            const Set::Element& a = left[i];
+            const Set::Element& b = right[i];
+            if (a.type != b.type) return false;
+            if (a.type == Set::VALUE) {
+                if (a.atom != b.atom) return false;
+            } else if (!a.subset.sharesNodeWith(b.subset)) {
+                if (a.subset.fingerprint() != b.subset.fingerprint()) return false;
+                pending.push(Pair(&a.subset, &b.subset));
+            }
+        }
+    }
+    return true;
+}
+
+// Общий случай: узлам обоих деревьев снизу вверх назначаются номера
+// классов — равные множества получают один номер. Ключ класса —
+// отсортированный список без повторов из номеров атомов (чётные) и
+// классов вложенных детей (нечётные). Таблицы классов выделяются на
+// каждое сравнение: сюда попадают только равные по отпечатку деревья с
+// разным порядком детей.
+bool sameClasses(const Set::Subset& lhs, const Set::Subset& rhs) {
+    std::unordered_map<NodeKey, std::uint64_t> classes;
+    std::map<std::vector<std::uint64_t>, std::uint64_t> ids;
+    std::vector<const Set::Subset*> pending{&lhs, &rhs};
+    std::vector<std::uint64_t> key;
+    while (!pending.empty()) {
+        const Set::Subset& subset = *pending.back();
+        if (classes.count(subset.begin()) != 0) {
+            pending.pop_back();
+            continue;
+        }
+        bool ready = true;
+        for (const auto& child : subset) {
+            if (child.type == Set::NESTED_SET && classes.count(child.subset.begin()) == 0) {
+                pending.push_back(&child.subset);
+                ready = false;
+            }
+        }
+        if (!ready) continue;
+        pending.pop_back();
+        key.clear();
+        for (const auto& child : subset) {
+            key.push_back(child.type == Set::VALUE
+                ? std::uint64_t(child.atom.id()) << 1
+                : (classes[child.subset.begin()] << 1) | 1);
+        }
+        std::sort(key.begin(), key.end());
+        key.erase(std::unique(key.begin(), key.end()), key.end());
+        classes[subset.begin()] = ids.emplace(key, ids.size()).first->second;
+    }
+    return classes[lhs.begin()] == classes[rhs.begin()];
+}
+
+}
 
 bool operator==(const Set::Element& lhs, const Set::Element& rhs) {
+    SET_STATS_OPERATION("Element::operator==");
+    SET_STATS_COUNT(comparisons, 1);
     if (lhs.type != rhs.type) return false;
     if (lhs.type == Set::VALUE) return lhs.atom == rhs.atom;
     if (lhs.type == Set::NESTED_SET) {
-        Set tempA(lhs.subset);
-        Set tempB(rhs.subset);
-        return tempA == tempB;
+        if (lhs.subset.sharesNodeWith(rhs.subset)) return true;
+        // Разные канонические узлы одного хранилища всегда различны
+        const SubsetStore* store = lhs.subset.store();
+        if (store != nullptr && store == rhs.subset.store()) return false;
+        // Разные отпечатки доказывают неравенство; равные проверяются
+        // поэлементно, без временных множеств и без рекурсии
+        if (lhs.subset.fingerprint() != rhs.subset.fingerprint()) return false;
+        return sameLayout(lhs.subset, rhs.subset) || sameClasses(lhs.subset, rhs.subset);
     }
     return false;
 }
@@ -22,32 +443,188 @@ bool operator!=(const Set::Element& lhs, const Set::Element& rhs) {
     return !(lhs == rhs);
 }
 
+std::size_t Set::ElementHash::operator()(const Element& element) const {
+    if (element.type == VALUE) {
+        return static_cast<std::size_t>(mixHash(element.atom.id()));
+    }
+    return static_cast<std::size_t>(element.subset.fingerprint());
+}
+
 Set::Set() = default;
 
+Set::Set(std::pmr::memory_resource* resource) : storage_(resource) {}
+
 Set::Set(const std::string& serialized) {
     loadFromString(serialized);
 }
 
-Set::Set(const std::vector<Element>& items) : storage_(items) {
+Set::Set(const std::string& serialized, std::pmr::memory_resource* resource) : storage_(resource) {
+    loadFromString(serialized);
+}
+
+Set::Set(const std::vector<Element>& items) : storage_(items.begin(), items.end()) {
     eliminateDuplicates();
 }
 
-Set::Set(const Set& other) : storage_(other.storage_) {}
+Set::Set(std::vector<Element>&& items) {
+    storage_.reserve(items.size());
+    for (auto& item : items) {
+        storage_.push_back(std::move(item));
+    }
+    eliminateDuplicates();
+}
+
+Set::Set(const Set& other)
+    : storage_(other.storage_),
+      serialized_(std::atomic_load_explicit(&other.serialized_, std::memory_order_acquire)),
+      hash_(other.hash_.load(std::memory_order_relaxed)),
+      filterEnabled_(other.filterEnabled_) {
+    countCopy(other.storage_.size());
+}
 
+Set::Set(const Set& other, std::pmr::memory_resource* resource)
+    : storage_(other.storage_, resource),
+      serialized_(std::atomic_load_explicit(&other.serialized_, std::memory_order_acquire)),
+      hash_(other.hash_.load(std::memory_order_relaxed)),
+      filterEnabled_(other.filterEnabled_) {
+    countCopy(other.storage_.size());
+}
+
+Set::Set(Set&& other) noexcept
+    : storage_(std::move(other.storage_)),
+      serialized_(std::move(other.serialized_)),
+      hash_(other.hash_.exchange(0, std::memory_order_relaxed)),
+      filter_(other.filter_.exchange(nullptr, std::memory_order_relaxed)),
+      filterEnabled_(other.filterEnabled_),
+      fingerprints_(other.fingerprints_.exchange(nullptr, std::memory_order_relaxed)) {}
+
+Set::~Set() {
+    dropFilter();
+    dropFingerprints();
+}
+
+// Присваивание сохраняет ресурс левой стороны: элементы из чужого
+// ресурса строятся заново через аллокатор storage_
 Set& Set::operator=(const Set& other) {
+    SET_STATS_OPERATION("operator=");
     if (this != &other) {
-        storage_ = other.storage_;
+        std::pmr::vector<Element> copy(other.storage_.begin(), other.storage_.end(), storage_.get_allocator());
+        countCopy(copy.size());
+        storage_.swap(copy);
+        serialized_ = std::atomic_load_explicit(&other.serialized_, std::memory_order_acquire);
+        hash_.store(other.hash_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        dropFilter();
+        dropFingerprints();
+        filterEnabled_ = other.filterEnabled_;
+    }
+    return *this;
+}
+
+Set& Set::operator=(Set&& other) {
+    if (this != &other) {
+        if (storage_.get_allocator() == other.storage_.get_allocator()) {
+            storage_ = std::move(other.storage_);
+        } else {
+            storage_.clear();
+            storage_.reserve(other.storage_.size());
+            for (auto& element : other.storage_) {
+                storage_.push_back(std::move(element));
+            }
+            other.storage_.clear();
+        }
+        serialized_ = std::move(other.serialized_);
+        hash_.store(other.hash_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        other.invalidate();
+        dropFilter();
+        filter_.store(other.filter_.exchange(nullptr, std::memory_order_relaxed), std::memory_order_relaxed);
+        filterEnabled_ = other.filterEnabled_;
+        dropFingerprints();
+        fingerprints_.store(other.fingerprints_.exchange(nullptr, std::memory_order_relaxed),
+                            std::memory_order_relaxed);
     }
     return *this;
 }
 
 bool Set::contains(const Element& item) const {
+    SET_STATS_OPERATION("contains");
+    if (const BloomFilter* filter = membershipFilter()) {
+        if (!filter->mayContain(ElementHash()(item))) return false;
+    }
+    return scan(item);
+}
+
+bool Set::scan(const Element& item) const {
     for (const auto& el : storage_) {
         if (el == item) return true;
     }
     return false;
 }
 
+// Проверка перед вставкой: хеш считается один раз и для запроса к
+// фильтру, и для его пополнения
+bool Set::absent(const Element& item, std::uint64_t& hash) const {
+    const BloomFilter* filter = membershipFilter();
+    if (filter == nullptr) return !scan(item);
+    hash = ElementHash()(item);
+    return !filter->mayContain(hash) || !scan(item);
+}
+
+const BloomFilter* Set::membershipFilter() const {
+    if (!filterEnabled_) return nullptr;
+    // Уже построенный фильтр используется и после того, как множество
+    // стало меньше порога: вставки должны попадать в него
+    BloomFilter* filter = filter_.load(std::memory_order_acquire);
+    if (filter != nullptr || storage_.size() < FILTER_THRESHOLD) return filter;
+    auto built = std::make_unique<BloomFilter>(storage_.size() * 2);
+    for (const auto& element : storage_) {
+        built->add(ElementHash()(element));
+    }
+    // Параллельные читатели могут построить фильтр одновременно:
+    // остаётся опубликованный первым
+    if (filter_.compare_exchange_strong(filter, built.get(), std::memory_order_acq_rel)) {
+        return built.release();
+    }
+    return filter;
+}
+
+void Set::filterInserted(std::uint64_t hash) {
+    BloomFilter* filter = filter_.load(std::memory_order_relaxed);
+    if (filter == nullptr) return;
+    if (filter->entries() >= filter->capacity()) {
+        dropFilter();
+    } else {
+        filter->add(hash);
+    }
+}
+
+void Set::filterRemoved(std::size_t count) {
+    BloomFilter* filter = filter_.load(std::memory_order_relaxed);
+    if (filter == nullptr || count == 0) return;
+    filter->noteRemoved(count);
+    if (filter->removed() * 2 > filter->entries()) dropFilter();
+}
+
+void Set::dropFilter() {
+    delete filter_.exchange(nullptr, std::memory_order_relaxed);
+}
+
+void Set::setFilterEnabled(bool enabled) {
+    filterEnabled_ = enabled;
+    if (!enabled) dropFilter();
+}
+
+Set::FilterStats Set::filterStats() const {
+    FilterStats stats{false, 0, 0, 0, 0.0};
+    const BloomFilter* filter = filter_.load(std::memory_order_acquire);
+    if (filter == nullptr) return stats;
+    stats.active = true;
+    stats.entries = filter->entries() - filter->removed();
+    stats.bits = filter->bits();
+    stats.bytes = filter->memoryUsage();
+    stats.falsePositiveRate = filter->falsePositiveRate();
+    return stats;
+}
+
 bool Set::isEmpty() const {
     return storage_.empty();
 }
@@ -57,78 +634,272 @@ std::size_t Set::size() const {
 }
 
 void Set::insert(const Element& item) {
-    if (!contains(item)) {
+    SET_STATS_OPERATION("insert");
+    std::uint64_t hash = 0;
+    if (absent(item, hash)) {
         storage_.push_back(item);
+        invalidate();
+        filterInserted(hash);
+    }
+}
+
+void Set::insert(Element&& item) {
+    SET_STATS_OPERATION("insert");
+    std::uint64_t hash = 0;
+    if (absent(item, hash)) {
+        storage_.push_back(std::move(item));
+        invalidate();
+        filterInserted(hash);
     }
 }
 
 void Set::erase(const Element& item) {
+    SET_STATS_OPERATION("erase");
+    const std::size_t before = storage_.size();
     storage_.erase(
         std::remove_if(storage_.begin(), storage_.end(),
             [&item](const Element& current) { return current == item; }),
         storage_.end()
     );
+    invalidate();
+    filterRemoved(before - storage_.size());
 }
 
-Set Set::unite(const Set& other) const {
-    Set result(*this);
-    for (const auto& element : other.storage_) {
-        result.insert(element);
-    }
+Set::const_iterator Set::begin() const {
+    return storage_.begin();
+}
+
+Set::const_iterator Set::end() const {
+    return storage_.end();
+}
+
+std::pmr::memory_resource* Set::resource() const {
+    return storage_.get_allocator().resource();
+}
+
+Set Set::unite(const Set& other) const & {
+    SET_STATS_OPERATION("unite");
+    Set result(*this, resource());
+    result.selfUnite(other);
     return result;
 }
 
+Set Set::unite(const Set& other) && {
+    SET_STATS_OPERATION("unite");
+    selfUnite(other);
+    return std::move(*this);
+}
+
+// Когда оба операнда длиннее SMALL_DEDUP, принадлежность проверяется по
+// хеш-индексу и операция линейна; иначе перебором
 Set& Set::selfUnite(const Set& other) {
+    SET_STATS_OPERATION("selfUnite");
+    if (storage_.size() <= SMALL_DEDUP || other.storage_.size() <= SMALL_DEDUP) {
+        for (const auto& element : other.storage_) {
+            insert(element);
+        }
+        return *this;
+    }
+    if (&other == this) return *this;
+    // Индекс хранит указатели на элементы, поэтому место резервируется заранее
+    storage_.reserve(storage_.size() + other.storage_.size());
+    const std::size_t before = storage_.size();
+    ElementIndex seen(*this);
     for (const auto& element : other.storage_) {
-        insert(element);
+        if (!seen.contains(element)) storage_.push_back(element);
+    }
+    if (storage_.size() != before) {
+        invalidate();
+        dropFilter();
     }
     return *this;
 }
 
-Set Set::intersect(const Set& other) const {
-    Set result;
-    for (const auto& element : storage_) {
-        if (other.contains(element)) {
-            result.insert(element);
+Set Set::intersect(const Set& other) const & {
+    SET_STATS_OPERATION("intersect");
+    // Элементы *this различны, поэтому результат пополняется без проверок
+    Set result(resource());
+    if (storage_.size() <= SMALL_DEDUP || other.storage_.size() <= SMALL_DEDUP) {
+        for (const auto& element : storage_) {
+            if (other.contains(element)) result.storage_.push_back(element);
         }
+        return result;
+    }
+    ElementIndex index(other);
+    for (const auto& element : storage_) {
+        if (index.contains(element)) result.storage_.push_back(element);
     }
     return result;
 }
 
+Set Set::intersect(const Set& other) && {
+    SET_STATS_OPERATION("intersect");
+    selfIntersect(other);
+    return std::move(*this);
+}
+
 Set& Set::selfIntersect(const Set& other) {
-    std::vector<Element> intersection;
-    for (const auto& element : storage_) {
-        if (other.contains(element)) {
-            intersection.push_back(element);
-        }
+    SET_STATS_OPERATION("selfIntersect");
+    if (&other == this) return *this;
+    const std::size_t before = storage_.size();
+    if (storage_.size() <= SMALL_DEDUP || other.storage_.size() <= SMALL_DEDUP) {
+        storage_.erase(
+            std::remove_if(storage_.begin(), storage_.end(),
+                [&other](const Element& element) { return !other.contains(element); }),
+            storage_.end()
+        );
+    } else {
+        ElementIndex index(other);
+        storage_.erase(
+            std::remove_if(storage_.begin(), storage_.end(),
+                [&index](const Element& element) { return !index.contains(element); }),
+            storage_.end()
+        );
     }
-    storage_ = intersection;
+    invalidate();
+    filterRemoved(before - storage_.size());
     return *this;
 }
 
-Set Set::difference(const Set& other) const {
-    Set result;
-    for (const auto& element : storage_) {
-        if (!other.contains(element)) {
-            result.insert(element);
+Set Set::difference(const Set& other) const & {
+    SET_STATS_OPERATION("difference");
+    Set result(resource());
+    if (storage_.size() <= SMALL_DEDUP || other.storage_.size() <= SMALL_DEDUP) {
+        for (const auto& element : storage_) {
+            if (!other.contains(element)) result.storage_.push_back(element);
         }
+        return result;
+    }
+    ElementIndex index(other);
+    for (const auto& element : storage_) {
+        if (!index.contains(element)) result.storage_.push_back(element);
     }
     return result;
 }
 
+Set Set::difference(const Set& other) && {
+    SET_STATS_OPERATION("difference");
+    selfDifference(other);
+    return std::move(*this);
+}
+
 Set& Set::selfDifference(const Set& other) {
-    storage_.erase(
-        std::remove_if(storage_.begin(), storage_.end(),
-            [&other](const Element& element) { return other.contains(element); }),
-        storage_.end()
-    );
+    SET_STATS_OPERATION("selfDifference");
+    const std::size_t before = storage_.size();
+    if (&other == this) {
+        storage_.clear();
+    } else if (storage_.size() <= SMALL_DEDUP || other.storage_.size() <= SMALL_DEDUP) {
+        storage_.erase(
+            std::remove_if(storage_.begin(), storage_.end(),
+                [&other](const Element& element) { return other.contains(element); }),
+            storage_.end()
+        );
+    } else {
+        ElementIndex index(other);
+        storage_.erase(
+            std::remove_if(storage_.begin(), storage_.end(),
+                [&index](const Element& element) { return index.contains(element); }),
+            storage_.end()
+        );
+    }
+    invalidate();
+    filterRemoved(before - storage_.size());
     return *this;
 }
 
+bool Set::isSubsetOf(const Set& other) const {
+    SET_STATS_OPERATION("isSubsetOf");
+    if (this == &other || storage_.empty()) return true;
+    if (storage_.size() > other.storage_.size()) return false;
+    if (storage_.size() == other.storage_.size()) {
+        // При равных размерах подмножество возможно только при равенстве
+        const std::uint64_t hash = hash_.load(std::memory_order_relaxed);
+        const std::uint64_t otherHash = other.hash_.load(std::memory_order_relaxed);
+        if (hash != 0 && otherHash != 0 && hash != otherHash) return false;
+    }
+    for (const auto& element : storage_) {
+        if (!other.holds(element)) return false;
+    }
+    return true;
+}
+
+bool Set::isSupersetOf(const Set& other) const {
+    return other.isSubsetOf(*this);
+}
+
+bool Set::isDisjointFrom(const Set& other) const {
+    SET_STATS_OPERATION("isDisjointFrom");
+    if (storage_.empty() || other.storage_.empty()) return true;
+    if (this == &other) return false;
+    // Обходится меньшее множество, ищется в большем
+    const Set& smaller = storage_.size() <= other.storage_.size() ? *this : other;
+    const Set& larger = &smaller == this ? other : *this;
+    for (const auto& element : smaller.storage_) {
+        if (larger.holds(element)) return false;
+    }
+    return true;
+}
+
+std::size_t Set::intersectionSize(const Set& other) const {
+    SET_STATS_OPERATION("intersectionSize");
+    if (this == &other) return storage_.size();
+    const Set& smaller = storage_.size() <= other.storage_.size() ? *this : other;
+    const Set& larger = &smaller == this ? other : *this;
+    std::size_t count = 0;
+    for (const auto& element : smaller.storage_) {
+        if (larger.holds(element)) ++count;
+    }
+    return count;
+}
+
+bool Set::holds(const Element& item) const {
+    if (storage_.size() <= SMALL_DEDUP) return scan(item);
+    const auto& entries = fingerprintIndex().entries;
+    const std::uint64_t hash = ElementHash()(item);
+    auto it = std::lower_bound(entries.begin(), entries.end(), hash,
+        [](const std::pair<std::uint64_t, std::size_t>& entry, std::uint64_t value) { return entry.first < value; });
+    for (; it != entries.end() && it->first == hash; ++it) {
+        if (storage_[it->second] == item) return true;
+    }
+    return false;
+}
+
+const Set::FingerprintIndex& Set::fingerprintIndex() const {
+    FingerprintIndex* index = fingerprints_.load(std::memory_order_acquire);
+    if (index != nullptr) return *index;
+    auto built = std::make_unique<FingerprintIndex>();
+    built->entries.reserve(storage_.size());
+    for (std::size_t i = 0; i < storage_.size(); ++i) {
+        built->entries.emplace_back(ElementHash()(storage_[i]), i);
+    }
+    std::sort(built->entries.begin(), built->entries.end());
+    // Как и фильтр, индекс публикуется первым построившим его читателем
+    if (fingerprints_.compare_exchange_strong(index, built.get(), std::memory_order_acq_rel)) {
+        return *built.release();
+    }
+    return *index;
+}
+
+void Set::dropFingerprints() {
+    delete fingerprints_.exchange(nullptr, std::memory_order_relaxed);
+}
+
 bool Set::operator==(const Set& other) const {
+    SET_STATS_OPERATION("operator==");
     if (storage_.size() != other.storage_.size()) return false;
+    // Уже вычисленные хеши отсекают большинство неравных пар
+    const std::uint64_t hash = hash_.load(std::memory_order_relaxed);
+    const std::uint64_t otherHash = other.hash_.load(std::memory_order_relaxed);
+    if (hash != 0 && otherHash != 0 && hash != otherHash) return false;
+    if (storage_.size() <= SMALL_DEDUP) {
+        for (const auto& element : storage_) {
+            if (!other.contains(element)) return false;
+        }
+        return true;
+    }
+    ElementIndex index(other);
     for (const auto& element : storage_) {
-        if (!other.contains(element)) return false;
+        if (!index.contains(element)) return false;
     }
     return true;
 }
@@ -142,116 +913,320 @@ bool Set::has(const Element& item) const {
 }
 
 Set Set::powerSet() const {
-    Set result;
-    result.insert(Element(std::vector<Element>()));
+    SET_STATS_OPERATION("powerSet");
+    Set result(resource());
     std::size_t n = storage_.size();
     std::size_t total = 1ULL << n;
+    result.storage_.reserve(total);
+    result.storage_.push_back(Element(Subset()));
+    std::vector<Element> subset;
     for (std::size_t i = 1; i < total; ++i) {
-        std::vector<Element> subset;
         for (std::size_t j = 0; j < n; ++j) {
             if (i & (1ULL << j)) {
                 subset.push_back(storage_[j]);
             }
         }
-        result.insert(Element(subset));
+        result.storage_.push_back(Element(Subset(subset, 0, result.resource())));
     }
     return result;
 }
 
-Set::Element Set::parseAtomic(const std::string& str, std::size_t& index) const {
-    while (index < str.size() && isWhitespace(str[index])) ++index;
-    if (index < str.size() && str[index] == '{') {
-        return parseGroup(str, index);
+std::size_t Set::memoryUsage() const {
+    std::size_t bytes = sizeof(Set) + storage_.capacity() * sizeof(Element);
+    if (auto text = std::atomic_load_explicit(&serialized_, std::memory_order_acquire)) {
+        bytes += sizeof(std::string) + text->capacity() + 1;
     }
-    std::string token;
-    while (index < str.size() && str[index] != ',' && str[index] != '}' && !isWhitespace(str[index])) {
-        if (str[index] == '{') {
+    if (const BloomFilter* filter = filter_.load(std::memory_order_acquire)) {
+        bytes += filter->memoryUsage();
+    }
+    if (const FingerprintIndex* index = fingerprints_.load(std::memory_order_acquire)) {
+        bytes += sizeof(FingerprintIndex) + index->entries.capacity() * sizeof(index->entries[0]);
+    }
+    std::unordered_set<const Subset::Node*> nodes;
+    std::unordered_set<std::uint32_t> atoms;
+    std::vector<Subset::Node*> pending;
+    auto visit = [&](const Element& element) {
+        if (element.type == VALUE) {
+            atoms.insert(element.atom.id());
+        } else if (element.subset.node_ != nullptr && nodes.insert(element.subset.node_).second) {
+            pending.push_back(element.subset.node_);
+        }
+    };
+    for (const auto& element : storage_) {
+        visit(element);
+    }
+    while (!pending.empty()) {
+        Subset::Node* node = pending.back();
+        pending.pop_back();
+        bytes += Subset::Node::bytes(node->size);
+        for (std::uint32_t i = 0; i < node->size; ++i) {
+            visit(node->children()[i]);
+        }
+    }
+    // Короткие строки лежат внутри объекта std::string и кучи не занимают
+    for (std::uint32_t id : atoms) {
+        const std::string& value = AtomTable::instance().lookup(id);
+        const char* data = value.data();
+        const char* object = reinterpret_cast<const char*>(&value);
+        if (data < object || data >= object + sizeof(std::string)) {
+            bytes += value.capacity() + 1;
+        }
+    }
+    return bytes;
+}
+
+namespace {
+
+// Узлы равны, если совпадают ресурс и дети поэлементно: атомы по номеру,
+// вложенные множества по адресу узла (дети к этому моменту уже общие)
+struct SharedNodeHash {
+    std::size_t operator()(const Set::Subset& subset) const {
+        std::uint64_t hash = mixHash(reinterpret_cast<std::uintptr_t>(subset.resource()));
+        for (const auto& child : subset) {
+            const std::uint64_t key = child.type == Set::VALUE
+                ? child.atom.id()
+                : reinterpret_cast<std::uintptr_t>(child.subset.begin()) | 1;
+            hash = mixHash(hash ^ key);
+        }
+        return static_cast<std::size_t>(hash);
+    }
+};
+
+struct SharedNodeEqual {
+    bool operator()(const Set::Subset& lhs, const Set::Subset& rhs) const {
+        if (lhs.resource() != rhs.resource() || lhs.size() != rhs.size()) return false;
+        for (std::size_t i = 0; i < lhs.size(); ++i) {
+            const Set::Element& a = lhs[i];
+            const Set::Element& b = rhs[i];
+            if (a.type != b.type || a.atom != b.atom || !a.subset.sharesNodeWith(b.subset)) return false;
+        }
+        return true;
+    }
+};
+
+}
+
+void Set::compact() {
+    storage_.shrink_to_fit();
+    // Атомы интернированы глобально, поэтому делить остаётся только узлы.
+    // Обход снизу вверх с явным стеком: дети узла становятся общими раньше
+    // самого узла. Спускаться можно только в узлы, которыми множество
+    // владеет одно, — разделённые с другими объектами узлы не меняются.
+    // Пул держит ссылки на общие узлы, пока идёт уплотнение.
+    std::unordered_set<Subset, SharedNodeHash, SharedNodeEqual> shared;
+    struct Frame {
+        Subset* subset;
+        std::uint32_t next;
+    };
+    std::vector<Frame> stack;
+    for (auto& element : storage_) {
+        if (element.type != NESTED_SET || element.subset.empty()) continue;
+        stack.push_back(Frame{&element.subset, 0});
+        while (!stack.empty()) {
+            Frame& frame = stack.back();
+            Subset::Node* node = frame.subset->node_;
+            if (frame.next < node->size && node->refs.load(std::memory_order_relaxed) == 1) {
+                Element& child = node->children()[frame.next++];
+                if (child.type == NESTED_SET && !child.subset.empty()) {
+                    stack.push_back(Frame{&child.subset, 0});
+                }
+                continue;
+            }
+            Subset* subset = frame.subset;
+            stack.pop_back();
+            auto found = shared.find(*subset);
+            if (found == shared.end()) {
+                shared.insert(*subset);
+            } else if (!found->sharesNodeWith(*subset)) {
+                *subset = *found;
+            }
+        }
+    }
+}
+
+Set::Element Set::parseToken(std::string_view str, std::size_t& index) const {
+    const std::size_t begin = index;
+    while (index < str.size() && str[index] != ',' && str[index] != '}') {
+        const char ch = str[index];
+        if (ch == '{') {
             throw std::invalid_argument("Unexpected '{' inside token");
         }
-        token += str[index];
+        if (!isDigit(ch) && !isLetter(ch) && ch != '_' && !isWhitespace(ch)) {
+            throw std::invalid_argument("Invalid character: " + std::string(1, ch));
+        }
         ++index;
     }
+    return tokenElement(str.substr(begin, index - begin));
+}
+
+Set::Element Set::tokenElement(std::string_view raw) const {
+    // Токен — срез входа; пробелы внутри токена игнорируются, как и
+    // раньше, поэтому копия строится только если они встретились.
+    std::size_t begin = 0;
+    std::size_t end = raw.size();
+    while (begin < end && isWhitespace(raw[begin])) ++begin;
+    while (end > begin && isWhitespace(raw[end - 1])) --end;
+    std::string_view token = raw.substr(begin, end - begin);
+    bool hasInnerSpace = false;
     for (char ch : token) {
-        if (!isDigit(ch) && !isLetter(ch) && ch != '_') {
-            throw std::invalid_argument("Invalid character: " + std::string(1, ch));
+        if (isWhitespace(ch)) {
+            hasInnerSpace = true;
+            break;
         }
     }
-    return Element(token);
+    if (!hasInnerSpace) {
+        return Element(Atom(token));
+    }
+    std::string compact;
+    compact.reserve(token.size());
+    for (char ch : token) {
+        if (!isWhitespace(ch)) compact += ch;
+    }
+    return Element(Atom(compact));
 }
 
-Set::Element Set::parseGroup(const std::string& str, std::size_t& index) const {
-    if (str[index] != '{') {
+void Set::parseGroups(std::string_view str, std::size_t& index, std::vector<Element>& scratch) const {
+    if (index >= str.size() || str[index] != '{') {
         throw std::invalid_argument("Expected '{'");
     }
     ++index;
-    std::vector<Element> items;
-    while (index < str.size()) {
-        while (index < str.size() && isWhitespace(str[index])) ++index;
-        if (index < str.size() && str[index] == '}') {
+    // Для каждой открытой группы хранится начало её детей в scratch;
+    // закрытая группа переносит свой хвост scratch в узел
+    std::vector<std::size_t> marks{scratch.size()};
+    while (true) {
+        skipWhitespace(str, index);
+        if (index >= str.size()) {
+            throw std::invalid_argument("Expected '}'");
+        }
+        if (str[index] == '{') {
             ++index;
-            break;
+            marks.push_back(scratch.size());
+            continue;
+        }
+        if (str[index] == '}') {
+            ++index;
+            const std::size_t mark = marks.back();
+            marks.pop_back();
+            if (marks.empty()) return;
+            Element group(Subset(scratch, mark, resource()));
+            scratch.push_back(std::move(group));
+        } else {
+            scratch.push_back(parseToken(str, index));
         }
-        Element el = parseAtomic(str, index);
-        items.push_back(el);
-        while (index < str.size() && isWhitespace(str[index])) ++index;
+        skipWhitespace(str, index);
         if (index < str.size() && str[index] == ',') {
             ++index;
         } else if (index < str.size() && str[index] != '}') {
             throw std::invalid_argument("Expected ',' or '}'");
         }
     }
-    return Element(items);
 }
 
-void Set::loadFromString(const std::string& input) {
+bool Set::parseIndexed(std::string_view str, std::size_t first, const StructuralIndex& index,
+                       std::vector<Element>& scratch) const {
+    const auto& positions = index.positions;
+    if (!index.valid || positions.empty() || positions.front() != first) return false;
+    auto blank = [this, str](std::size_t from, std::size_t to) {
+        for (std::size_t i = from; i < to; ++i) {
+            if (!isWhitespace(str[i])) return false;
+        }
+        return true;
+    };
+    // Между соседними структурными символами лежит не более одного токена;
+    // символы токенов уже проверены сканером
+    std::vector<std::size_t> marks{scratch.size()};
+    bool afterGroup = false;
+    for (std::size_t k = 1; k < positions.size(); ++k) {
+        const std::size_t from = positions[k - 1] + 1;
+        const std::size_t at = positions[k];
+        const char c = str[at];
+        if (afterGroup) {
+            if (!blank(from, at) || c == '{') return false;
+            afterGroup = false;
+            if (c == ',') continue;
+        } else if (c == '{') {
+            if (!blank(from, at)) return false;
+            marks.push_back(scratch.size());
+            continue;
+        } else if (c == ',' || !blank(from, at)) {
+            scratch.push_back(tokenElement(str.substr(from, at - from)));
+            if (c == ',') continue;
+        }
+        // c == '}': группа закрывается
+        const std::size_t mark = marks.back();
+        marks.pop_back();
+        if (marks.empty()) return k + 1 == positions.size() && at + 1 == str.size();
+        Element group(Subset(scratch, mark, resource()));
+        scratch.push_back(std::move(group));
+        afterGroup = true;
+    }
+    return false;
+}
+
+void Set::loadFromString(std::string_view input) {
     storage_.clear();
-    std::string clean = input;
-    clean.erase(std::remove_if(clean.begin(), clean.end(),
-        [this](char c) { return isWhitespace(c); }), clean.end());
-    
+    invalidate();
+    dropFilter();
+    std::size_t first = 0;
+    skipWhitespace(input, first);
+    std::size_t last = input.size();
+    while (last > first && isWhitespace(input[last - 1])) --last;
+
     // Исправлено: проверка на пустую строку и корректность формата
-    if (clean.empty() || clean[0] != '{' || clean.back() != '}') {
+    if (first == last || input[first] != '{' || input[last - 1] != '}') {
         throw std::invalid_argument("Invalid set format");
     }
-    
-    std::size_t pos = 0;
-    Element root = parseGroup(clean, pos);
-    
-    // Исправлено: проверка что весь вход был обработан
-    if (pos != clean.size()) {
-        throw std::invalid_argument("Unexpected characters at the end");
+
+    std::vector<Element> items;
+    const std::string_view body = input.substr(0, last);
+    if (!parseIndexed(body, first, StructuralScanner::scan(body), items)) {
+        // Точный текст ошибки даёт посимвольный разбор
+        items.clear();
+        std::size_t pos = first;
+        parseGroups(body, pos, items);
+
+        // Исправлено: проверка что весь вход был обработан
+        if (pos != last) {
+            throw std::invalid_argument("Unexpected characters at the end");
+        }
+    }
+
+    storage_.reserve(items.size());
+    for (auto& item : items) {
+        storage_.push_back(std::move(item));
     }
-    
-    storage_ = root.subset;
     eliminateDuplicates();
 }
 
-void Set::eliminateDuplicates() {
-    std::vector<Element> unique;
-    for (const auto& elem : storage_) {
-        bool found = false;
-        for (const auto& u : unique) {
-            if (u == elem) {
-                found = true;
-                break;
-            }
+void Set::appendElement(std::string& out, const Element& elem) const {
+    if (elem.type == VALUE) {
+        out += elem.atom.str();
+        return;
+    }
+    // Обход в глубину с явным стеком позиций внутри открытых групп
+    std::vector<std::pair<const Subset*, std::size_t>> stack;
+    stack.emplace_back(&elem.subset, 0);
+    out += '{';
+    while (!stack.empty()) {
+        auto& [subset, next] = stack.back();
+        if (next == subset->size()) {
+            out += '}';
+            stack.pop_back();
+            continue;
         }
-        if (!found) {
-            unique.push_back(elem);
+        if (next > 0) out += ", ";
+        const Element& child = (*subset)[next++];
+        if (child.type == VALUE) {
+            out += child.atom.str();
+        } else {
+            out += '{';
+            stack.emplace_back(&child.subset, 0);
         }
     }
-    storage_ = unique;
 }
 
-std::string Set::stringifyElement(const Element& elem) const {
-    if (elem.type == VALUE) return elem.atom;
-    std::string result = "{";
-    for (std::size_t i = 0; i < elem.subset.size(); ++i) {
-        result += stringifyElement(elem.subset[i]);
-        if (i < elem.subset.size() - 1) result += ", ";
-    }
-    result += "}";
-    return result;
+void Set::skipWhitespace(std::string_view str, std::size_t& index) const {
+    while (index < str.size() && isWhitespace(str[index])) ++index;
 }
 
 bool Set::isWhitespace(char c) const {
@@ -268,22 +1243,53 @@ bool Set::isLetter(char c) const {
 }
 
 std::string Set::serialize() const {
-    if (isEmpty()) return "{}";
-    std::string result = "{";
+    SET_STATS_OPERATION("serialize");
+    return *serializedText();
+}
+
+std::shared_ptr<const std::string> Set::serializedText() const {
+    std::shared_ptr<const std::string> cached = std::atomic_load_explicit(&serialized_, std::memory_order_acquire);
+    if (cached) return cached;
+    // Весь вывод дописывается в один буфер
+    std::string result;
+    result.reserve(storage_.size() * 4 + 2);
+    result += '{';
     for (std::size_t i = 0; i < storage_.size(); ++i) {
-        result += stringifyElement(storage_[i]);
-        if (i < storage_.size() - 1) result += ", ";
+        if (i > 0) result += ", ";
+        appendElement(result, storage_[i]);
     }
-    result += "}";
-    return result;
+    result += '}';
+    // Параллельные читатели могут построить текст одновременно: тексты
+    // одинаковы, сохраняется любой из них
+    cached = std::make_shared<const std::string>(std::move(result));
+    std::atomic_store_explicit(&serialized_, cached, std::memory_order_release);
+    return cached;
+}
+
+std::uint64_t Set::contentHash() const {
+    std::uint64_t hash = hash_.load(std::memory_order_relaxed);
+    if (hash != 0) return hash;
+    hash = combineHashes(storage_.begin(), storage_.end());
+    if (hash == 0) hash = 1;
+    hash_.store(hash, std::memory_order_relaxed);
+    return hash;
+}
+
+void Set::invalidate() {
+    serialized_.reset();
+    hash_.store(0, std::memory_order_relaxed);
+    dropFingerprints();
 }
 
-Set Set::deserialize(const std::string& input) {
-    return Set(input);
+Set Set::deserialize(std::string_view input, std::pmr::memory_resource* resource) {
+    SET_STATS_OPERATION("deserialize");
+    Set result(resource);
+    result.loadFromString(input);
+    return result;
 }
 
 std::ostream& operator<<(std::ostream& os, const Set& set) {
-    os << set.serialize();
+    os << *set.serializedText();
     return os;
 }
 
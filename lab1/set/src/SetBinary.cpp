@@ -0,0 +1,79 @@
+#include "Set.h"
+#include "BinaryFormat.h"
+#include "MappedFile.h"
+#include <stdexcept>
+
+namespace {
+
+const std::string_view BINARY_MAGIC = "SETB";
+const std::uint8_t BINARY_VERSION = 1;
+const std::uint8_t FLAG_HASH = 0x01;
+
+}
+
+std::string Set::serializeBinary(bool withHash) const {
+    ElementEncoder encoder;
+    for (const auto& element : storage_) {
+        encoder.collect(element);
+    }
+    BinaryWriter out;
+    out.writeBytes(BINARY_MAGIC);
+    out.writeByte(BINARY_VERSION);
+    out.writeByte(withHash ? FLAG_HASH : 0);
+    encoder.writeAtomTable(out);
+    out.writeVarint(storage_.size());
+    for (const auto& element : storage_) {
+        encoder.writeElement(out, element);
+    }
+    if (withHash) {
+        out.writeFixed64(fnv1a64(out.buffer()));
+    }
+    return out.take();
+}
+
+Set Set::deserializeBinary(std::string_view data) {
+    BinaryReader header(data);
+    if (header.remaining() < BINARY_MAGIC.size() + 2 ||
+        header.readBytes(BINARY_MAGIC.size()) != BINARY_MAGIC) {
+        throw std::invalid_argument("Invalid binary set format");
+    }
+    if (header.readByte() != BINARY_VERSION) {
+        throw std::invalid_argument("Unsupported binary set version");
+    }
+    std::uint8_t flags = header.readByte();
+    if (flags & FLAG_HASH) {
+        if (data.size() < header.position() + 8) {
+            throw std::invalid_argument("Truncated binary set");
+        }
+        std::string_view payload = data.substr(0, data.size() - 8);
+        BinaryReader trailer(data.substr(payload.size()));
+        if (trailer.readFixed64() != fnv1a64(payload)) {
+            throw std::invalid_argument("Binary set checksum mismatch");
+        }
+        data = payload;
+    }
+
+    BinaryReader in(data.substr(header.position()));
+    ElementDecoder decoder;
+    decoder.readAtomTable(in);
+    std::uint64_t count = in.readVarint();
+    if (count > in.remaining()) {
+        throw std::invalid_argument("Truncated binary set");
+    }
+    Set result;
+    result.storage_.reserve(count);
+    for (std::uint64_t i = 0; i < count; ++i) {
+        result.storage_.push_back(decoder.readElement(in));
+    }
+    if (!in.atEnd()) {
+        throw std::invalid_argument("Unexpected data after binary set");
+    }
+    result.eliminateDuplicates();
+    return result;
+}
+
+Set Set::loadBinaryFile(const std::string& path) {
+    // Разбор идёт прямо по отображённым страницам, без чтения файла в строку
+    MappedFile file(path);
+    return deserializeBinary(file.view());
+}
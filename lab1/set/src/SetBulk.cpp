@@ -0,0 +1,355 @@
+#include "Set.h"
+#include "ElementIndex.h"
+#include "SetStats.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
+#include <unordered_set>
+
+namespace {
+
+// Элемент с заранее вычисленным хешем для индексов внутри раздела
+struct HashedElement {
+    const Set::Element* element;
+    std::size_t hash;
+
+    struct Hash {
+        std::size_t operator()(const HashedElement& item) const {
+            return item.hash;
+        }
+    };
+    struct Equal {
+        bool operator()(const HashedElement& lhs, const HashedElement& rhs) const {
+            return lhs.hash == rhs.hash && *lhs.element == *rhs.element;
+        }
+    };
+};
+
+// Номера элементов, разложенные по хеш-разделам: buckets[b][p] — номера
+// из b-го блока входа с хешем из раздела p, по возрастанию. Вход
+// проходится один раз, а не по разу на раздел, так что общая работа не
+// растёт с числом потоков.
+using Buckets = std::vector<std::vector<std::vector<std::size_t>>>;
+
+template <class HashAt>
+Buckets scatter(std::size_t count, std::size_t partitions, ThreadPool& pool, HashAt hashAt) {
+    const std::size_t blocks = partitions;
+    Buckets buckets(blocks, std::vector<std::vector<std::size_t>>(partitions));
+    pool.parallelFor(blocks, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t b = begin; b < end; ++b) {
+            std::vector<std::vector<std::size_t>>& local = buckets[b];
+            for (std::size_t i = count * b / blocks; i < count * (b + 1) / blocks; ++i) {
+                local[hashAt(i) % partitions].push_back(i);
+            }
+        }
+    });
+    return buckets;
+}
+
+// Обход раздела: блоки по порядку сохраняют порядок входа
+template <class Visitor>
+void forEachInPartition(const Buckets& buckets, std::size_t partition, Visitor visit) {
+    for (const auto& block : buckets) {
+        for (std::size_t i : block[partition]) visit(i);
+    }
+}
+
+// Ресурсы, из которых можно выделять память из нескольких потоков сразу
+bool synchronizedResource(std::pmr::memory_resource* resource) {
+    return resource == std::pmr::new_delete_resource()
+        || dynamic_cast<std::pmr::synchronized_pool_resource*>(resource) != nullptr;
+}
+
+// Отмечает в keep первые появления элементов одного хеш-раздела.
+// Разделы отмечают разные номера, поэтому их можно обрабатывать
+// параллельно, а затем собрать результат проходом по входу в его порядке.
+void markPartition(const std::vector<const Set::Element*>& items,
+                   const std::vector<std::size_t>& hashes,
+                   const Buckets& buckets, std::size_t partition,
+                   std::vector<char>& keep) {
+    auto hashOf = [&hashes](std::size_t i) { return hashes[i]; };
+    auto equal = [&items](std::size_t a, std::size_t b) { return *items[a] == *items[b]; };
+    std::unordered_set<std::size_t, decltype(hashOf), decltype(equal)> seen(16, hashOf, equal);
+    forEachInPartition(buckets, partition, [&](std::size_t i) {
+        if (seen.insert(i).second) keep[i] = 1;
+    });
+}
+
+}
+
+Set Set::uniteAll(const std::vector<const Set*>& sets, bool parallel) {
+    SET_STATS_OPERATION("uniteAll");
+    std::size_t total = 0;
+    for (const Set* set : sets) {
+        total += set->size();
+    }
+    Set result;
+    ThreadPool& pool = ThreadPool::shared();
+    if (!parallel || total < PARALLEL_THRESHOLD) {
+        ElementIndex seen;
+        seen.reserve(total);
+        for (const Set* set : sets) {
+            for (const auto& element : set->storage_) {
+                if (seen.insert(element)) {
+                    result.storage_.push_back(element);
+                }
+            }
+        }
+        return result;
+    }
+
+    std::vector<const Element*> items;
+    items.reserve(total);
+    for (const Set* set : sets) {
+        for (const auto& element : set->storage_) {
+            items.push_back(&element);
+        }
+    }
+    std::vector<std::size_t> hashes(items.size());
+    pool.parallelFor(items.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            hashes[i] = ElementHash()(*items[i]);
+        }
+    });
+    // Вызывающий поток участвует в работе наравне с потоками пула
+    const std::size_t partitions = pool.size() + 1;
+    const Buckets buckets = scatter(items.size(), partitions, pool, [&hashes](std::size_t i) { return hashes[i]; });
+    std::vector<char> keep(items.size(), 0);
+    pool.parallelFor(partitions, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            markPartition(items, hashes, buckets, p, keep);
+        }
+    });
+    // Порядок первого появления, как и в последовательной версии
+    result.storage_.reserve(static_cast<std::size_t>(std::count(keep.begin(), keep.end(), 1)));
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        if (keep[i]) result.storage_.push_back(*items[i]);
+    }
+    return result;
+}
+
+Set Set::intersectAll(const std::vector<const Set*>& sets, bool parallel) {
+    SET_STATS_OPERATION("intersectAll");
+    Set result;
+    if (sets.empty()) return result;
+    std::vector<const Set*> ordered(sets);
+    std::sort(ordered.begin(), ordered.end(),
+        [](const Set* lhs, const Set* rhs) { return lhs->size() < rhs->size(); });
+
+    std::vector<const Element*> candidates;
+    candidates.reserve(ordered.front()->size());
+    for (const auto& element : ordered.front()->storage_) {
+        candidates.push_back(&element);
+    }
+
+    ThreadPool& pool = ThreadPool::shared();
+    for (std::size_t k = 1; k < ordered.size() && !candidates.empty(); ++k) {
+        if (ordered[k] == ordered.front()) continue;
+        ElementIndex index(*ordered[k]);
+        if (parallel && candidates.size() >= PARALLEL_THRESHOLD) {
+            std::vector<char> keep(candidates.size());
+            pool.parallelFor(candidates.size(), [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    keep[i] = index.contains(*candidates[i]);
+                }
+            });
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < candidates.size(); ++i) {
+                if (keep[i]) candidates[kept++] = candidates[i];
+            }
+            candidates.resize(kept);
+        } else {
+            candidates.erase(
+                std::remove_if(candidates.begin(), candidates.end(),
+                    [&index](const Element* element) { return !index.contains(*element); }),
+                candidates.end()
+            );
+        }
+    }
+
+    result.storage_.reserve(candidates.size());
+    for (const Element* element : candidates) {
+        result.storage_.push_back(*element);
+    }
+    return result;
+}
+
+Set Set::parallelUnite(const Set& other) const {
+    return parallelUnite(other, ThreadPool::shared());
+}
+
+Set Set::parallelUnite(const Set& other, ThreadPool& pool) const {
+    SET_STATS_OPERATION("parallelUnite");
+    if (storage_.size() + other.storage_.size() < PARALLEL_THRESHOLD || pool.size() == 0) return unite(other);
+    return partitioned(other, Algebra::UNITE, pool);
+}
+
+Set Set::parallelIntersect(const Set& other) const {
+    return parallelIntersect(other, ThreadPool::shared());
+}
+
+Set Set::parallelIntersect(const Set& other, ThreadPool& pool) const {
+    SET_STATS_OPERATION("parallelIntersect");
+    if (storage_.size() + other.storage_.size() < PARALLEL_THRESHOLD || pool.size() == 0) return intersect(other);
+    return partitioned(other, Algebra::INTERSECT, pool);
+}
+
+Set Set::parallelDifference(const Set& other) const {
+    return parallelDifference(other, ThreadPool::shared());
+}
+
+Set Set::parallelDifference(const Set& other, ThreadPool& pool) const {
+    SET_STATS_OPERATION("parallelDifference");
+    if (storage_.size() + other.storage_.size() < PARALLEL_THRESHOLD || pool.size() == 0) return difference(other);
+    return partitioned(other, Algebra::DIFFERENCE, pool);
+}
+
+Set Set::partitioned(const Set& other, Algebra operation, ThreadPool& pool) const {
+    // Хеши обоих операндов считаются параллельно; равные элементы имеют
+    // равные хеши и попадают в один раздел
+    auto hashAll = [&pool](const std::pmr::vector<Element>& items) {
+        std::vector<HashedElement> hashed(items.size());
+        pool.parallelFor(items.size(), [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                hashed[i] = HashedElement{&items[i], ElementHash()(items[i])};
+            }
+        });
+        return hashed;
+    };
+    const std::vector<HashedElement> left = hashAll(storage_);
+    const std::vector<HashedElement> right = hashAll(other.storage_);
+
+    // Для объединения индексируется левый раздел и к нему дописываются
+    // новые элементы правого; для остальных операций индексируется правый
+    // раздел, а левый фильтруется по нему
+    const bool unite = operation == Algebra::UNITE;
+    const std::vector<HashedElement>& indexed = unite ? left : right;
+    const std::vector<HashedElement>& probed = unite ? right : left;
+    const bool keepFound = operation == Algebra::INTERSECT;
+
+    const std::size_t partitions = pool.size() + 1;
+    const Buckets indexedBuckets = scatter(indexed.size(), partitions, pool,
+        [&indexed](std::size_t i) { return indexed[i].hash; });
+    const Buckets probedBuckets = scatter(probed.size(), partitions, pool,
+        [&probed](std::size_t i) { return probed[i].hash; });
+    std::vector<std::vector<const Element*>> parts(partitions);
+    pool.parallelFor(partitions, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            std::unordered_set<HashedElement, HashedElement::Hash, HashedElement::Equal> index;
+            std::vector<const Element*>& out = parts[p];
+            forEachInPartition(indexedBuckets, p, [&](std::size_t i) {
+                index.insert(indexed[i]);
+                if (unite) out.push_back(indexed[i].element);
+            });
+            forEachInPartition(probedBuckets, p, [&](std::size_t i) {
+                if ((index.find(probed[i]) != index.end()) == keepFound) out.push_back(probed[i].element);
+            });
+        }
+    });
+
+    // Разделы склеиваются по порядку; копирование тоже идёт параллельно
+    std::vector<std::size_t> offsets(partitions + 1, 0);
+    for (std::size_t p = 0; p < partitions; ++p) {
+        offsets[p + 1] = offsets[p] + parts[p].size();
+    }
+    // Элементы из чужого ресурса копируются в ресурс результата, как и
+    // при push_back. Копия в своём ресурсе лишь увеличивает счётчик
+    // ссылок узла, а клон выделяет память из ресурса результата: из
+    // потоков пула это можно делать, только если ресурс потокобезопасен,
+    // иначе клоны строит вызывающий поток
+    Set result(resource());
+    result.storage_.resize(offsets[partitions]);
+    const Element::allocator_type allocator = result.storage_.get_allocator();
+    std::pmr::memory_resource* target = allocator.resource();
+    const bool shared = synchronizedResource(target);
+    auto foreign = [target](const Element& element) {
+        return !element.subset.empty() && element.subset.resource() != target;
+    };
+    pool.parallelFor(partitions, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            for (std::size_t i = 0; i < parts[p].size(); ++i) {
+                const Element& element = *parts[p][i];
+                if (shared || !foreign(element)) result.storage_[offsets[p] + i] = Element(element, allocator);
+            }
+        }
+    });
+    if (!shared) {
+        for (std::size_t p = 0; p < partitions; ++p) {
+            for (std::size_t i = 0; i < parts[p].size(); ++i) {
+                const Element& element = *parts[p][i];
+                if (foreign(element)) result.storage_[offsets[p] + i] = Element(element, allocator);
+            }
+        }
+    }
+    return result;
+}
+
+Set Set::symmetricDifference(const Set& other) const {
+    SET_STATS_OPERATION("symmetricDifference");
+    // Короткие операнды проверяются перебором, длинные — по индексу;
+    // части результата не пересекаются и уже без повторов
+    auto missing = [](const Set& set, const ElementIndex* index, const Element& element) {
+        return index != nullptr ? !index->contains(element) : !set.contains(element);
+    };
+    std::unique_ptr<ElementIndex> mine;
+    std::unique_ptr<ElementIndex> theirs;
+    if (storage_.size() > SMALL_DEDUP) mine = std::make_unique<ElementIndex>(*this);
+    if (other.storage_.size() > SMALL_DEDUP) theirs = std::make_unique<ElementIndex>(other);
+    Set result(resource());
+    for (const auto& element : storage_) {
+        if (missing(other, theirs.get(), element)) result.storage_.push_back(element);
+    }
+    for (const auto& element : other.storage_) {
+        if (missing(*this, mine.get(), element)) result.storage_.push_back(element);
+    }
+    return result;
+}
+
+void Set::eliminateDuplicates() {
+    const std::size_t count = storage_.size();
+    std::vector<char> keep(count, 0);
+    if (count <= SMALL_DEDUP) {
+        // Для коротких списков попарное сравнение дешевле хеширования
+        for (std::size_t i = 0; i < count; ++i) {
+            keep[i] = 1;
+            for (std::size_t j = 0; j < i; ++j) {
+                if (keep[j] && storage_[j] == storage_[i]) {
+                    keep[i] = 0;
+                    break;
+                }
+            }
+        }
+    } else if (count < PARALLEL_THRESHOLD) {
+        ElementIndex seen;
+        seen.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            keep[i] = seen.insert(storage_[i]);
+        }
+    } else {
+        std::vector<const Element*> items(count);
+        std::vector<std::size_t> hashes(count);
+        ThreadPool& pool = ThreadPool::shared();
+        pool.parallelFor(count, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                items[i] = &storage_[i];
+                hashes[i] = ElementHash()(storage_[i]);
+            }
+        });
+        const std::size_t partitions = pool.size() + 1;
+        const Buckets buckets = scatter(count, partitions, pool, [&hashes](std::size_t i) { return hashes[i]; });
+        pool.parallelFor(partitions, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t p = begin; p < end; ++p) {
+                markPartition(items, hashes, buckets, p, keep);
+            }
+        });
+    }
+    // Уплотнение на месте сохраняет порядок первого появления
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!keep[i]) continue;
+        if (kept != i) storage_[kept] = std::move(storage_[i]);
+        ++kept;
+    }
+    storage_.erase(storage_.begin() + static_cast<std::ptrdiff_t>(kept), storage_.end());
+}
@@ -0,0 +1,170 @@
+#include "SetCollection.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+void insertSorted(std::vector<SetCollection::SetId>& ids, SetCollection::SetId id) {
+    auto position = std::lower_bound(ids.begin(), ids.end(), id);
+    if (position == ids.end() || *position != id) ids.insert(position, id);
+}
+
+void eraseSorted(std::vector<SetCollection::SetId>& ids, SetCollection::SetId id) {
+    auto position = std::lower_bound(ids.begin(), ids.end(), id);
+    if (position != ids.end() && *position == id) ids.erase(position);
+}
+
+}
+
+SetCollection::SetCollection() : live_(0) {}
+
+SetCollection::SetId SetCollection::add(const Set& set) {
+    const SetId id = static_cast<SetId>(sets_.size());
+    sets_.emplace_back(set);
+    index(id, *sets_.back());
+    ++live_;
+    return id;
+}
+
+void SetCollection::update(SetId id, const Set& set) {
+    unindex(id, checked(id));
+    *sets_[id] = set;
+    index(id, *sets_[id]);
+}
+
+void SetCollection::remove(SetId id) {
+    unindex(id, checked(id));
+    sets_[id].reset();
+    --live_;
+}
+
+bool SetCollection::has(SetId id) const {
+    return id < sets_.size() && sets_[id].has_value();
+}
+
+const Set& SetCollection::get(SetId id) const {
+    return checked(id);
+}
+
+std::size_t SetCollection::size() const {
+    return live_;
+}
+
+const Set& SetCollection::checked(SetId id) const {
+    if (!has(id)) {
+        throw std::out_of_range("Unknown set id");
+    }
+    return *sets_[id];
+}
+
+void SetCollection::index(SetId id, const Set& set) {
+    if (set.isEmpty()) {
+        insertSorted(empty_, id);
+        return;
+    }
+    for (const auto& element : set) {
+        // Новые номера больше всех прежних, поэтому при add это push_back
+        insertSorted(postings_[element], id);
+    }
+}
+
+void SetCollection::unindex(SetId id, const Set& set) {
+    if (set.isEmpty()) {
+        eraseSorted(empty_, id);
+        return;
+    }
+    for (const auto& element : set) {
+        auto found = postings_.find(element);
+        if (found == postings_.end()) continue;
+        eraseSorted(found->second, id);
+        if (found->second.empty()) postings_.erase(found);
+    }
+}
+
+std::vector<SetCollection::SetId> SetCollection::containing(const Set::Element& element) const {
+    auto found = postings_.find(element);
+    return found == postings_.end() ? std::vector<SetId>() : found->second;
+}
+
+std::vector<SetCollection::SetId> SetCollection::supersetsOf(const Set& query) const {
+    if (query.isEmpty()) {
+        std::vector<SetId> all;
+        all.reserve(live_);
+        for (SetId id = 0; id < sets_.size(); ++id) {
+            if (sets_[id]) all.push_back(id);
+        }
+        return all;
+    }
+    // Пересечение начинается с самого короткого списка
+    std::vector<const Postings*> lists;
+    lists.reserve(query.size());
+    for (const auto& element : query) {
+        auto found = postings_.find(element);
+        if (found == postings_.end()) return {};
+        lists.push_back(&found->second);
+    }
+    std::sort(lists.begin(), lists.end(),
+        [](const Postings* lhs, const Postings* rhs) { return lhs->size() < rhs->size(); });
+    std::vector<SetId> result = *lists.front();
+    std::vector<SetId> next;
+    for (std::size_t i = 1; i < lists.size() && !result.empty(); ++i) {
+        next.clear();
+        std::set_intersection(result.begin(), result.end(), lists[i]->begin(), lists[i]->end(),
+                              std::back_inserter(next));
+        result.swap(next);
+    }
+    return result;
+}
+
+std::vector<SetCollection::SetId> SetCollection::overlaps(const Set& query, Counts& counts) const {
+    counts.clear();
+    std::vector<SetId> touched;
+    for (const auto& element : query) {
+        auto found = postings_.find(element);
+        if (found == postings_.end()) continue;
+        for (SetId id : found->second) {
+            if (counts[id]++ == 0) touched.push_back(id);
+        }
+    }
+    std::sort(touched.begin(), touched.end());
+    return touched;
+}
+
+std::vector<SetCollection::SetId> SetCollection::subsetsOf(const Set& query) const {
+    // Множество входит в запрос, если все его элементы нашлись в запросе;
+    // пустые множества входят в любой запрос
+    Counts counts;
+    std::vector<SetId> result;
+    for (SetId id : overlaps(query, counts)) {
+        if (counts[id] == sets_[id]->size()) result.push_back(id);
+    }
+    std::vector<SetId> merged;
+    merged.reserve(result.size() + empty_.size());
+    std::merge(result.begin(), result.end(), empty_.begin(), empty_.end(), std::back_inserter(merged));
+    return merged;
+}
+
+std::vector<SetCollection::Match> SetCollection::similarTo(const Set& query, double threshold) const {
+    Counts counts;
+    std::vector<SetId> candidates = overlaps(query, counts);
+    // Множества без общих элементов имеют сходство 0 (или 1, если оба
+    // пусты), поэтому перебирать их нужно только при малом пороге
+    if (threshold <= 0.0) {
+        candidates.clear();
+        for (SetId id = 0; id < sets_.size(); ++id) {
+            if (sets_[id]) candidates.push_back(id);
+        }
+    } else if (query.isEmpty()) {
+        candidates = empty_;
+    }
+    std::vector<Match> result;
+    for (SetId id : candidates) {
+        auto found = counts.find(id);
+        const std::size_t shared = found == counts.end() ? 0 : found->second;
+        const std::size_t unionSize = sets_[id]->size() + query.size() - shared;
+        const double similarity = unionSize == 0 ? 1.0 : static_cast<double>(shared) / unionSize;
+        if (similarity >= threshold) result.push_back(Match{id, similarity});
+    }
+    return result;
+}
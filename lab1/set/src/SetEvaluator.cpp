@@ -0,0 +1,132 @@
+#include "SetEvaluator.h"
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+SetEvaluator::SetEvaluator(std::string_view input) : input_(input), pos_(0) {}
+
+Set SetEvaluator::evaluate(std::string_view expression) {
+    SetEvaluator evaluator(expression);
+    Set result = evaluator.parseExpression();
+    evaluator.skipWhitespace();
+    if (evaluator.pos_ != expression.size()) {
+        throw std::invalid_argument("Unexpected characters at the end");
+    }
+    return result;
+}
+
+Set SetEvaluator::parseExpression() {
+    std::vector<Set> operands;
+    // Операции, ждущие правого операнда, и открытые скобки '('
+    std::vector<char> operations;
+    std::size_t open = 0;
+    while (true) {
+        // Операнд: открывающие скобки, затем литерал
+        skipWhitespace();
+        if (consume('(')) {
+            operations.push_back('(');
+            ++open;
+            continue;
+        }
+        if (pos_ >= input_.size() || input_[pos_] != '{') {
+            throw std::invalid_argument("Expected set or '('");
+        }
+        operands.push_back(parseLiteral());
+
+        // После операнда: закрывающие скобки, затем операция или конец
+        skipWhitespace();
+        while (open > 0 && consume(')')) {
+            while (operations.back() != '(') {
+                apply(operands, operations.back());
+                operations.pop_back();
+            }
+            operations.pop_back();
+            --open;
+            skipWhitespace();
+        }
+        const char next = pos_ < input_.size() ? input_[pos_] : '\0';
+        if (precedence(next) == 0) break;
+        ++pos_;
+        while (!operations.empty() && operations.back() != '(' &&
+               precedence(operations.back()) >= precedence(next)) {
+            apply(operands, operations.back());
+            operations.pop_back();
+        }
+        operations.push_back(next);
+    }
+    if (open > 0) {
+        throw std::invalid_argument("Expected ')'");
+    }
+    while (!operations.empty()) {
+        apply(operands, operations.back());
+        operations.pop_back();
+    }
+    return std::move(operands.back());
+}
+
+// & связывает сильнее; 0 — не операция
+int SetEvaluator::precedence(char operation) {
+    switch (operation) {
+        case '&':
+            return 2;
+        case '|':
+        case '-':
+        case '^':
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+void SetEvaluator::apply(std::vector<Set>& operands, char operation) {
+    Set right = std::move(operands.back());
+    operands.pop_back();
+    Set& left = operands.back();
+    switch (operation) {
+        case '&':
+            left = std::move(left).intersect(right);
+            break;
+        case '|':
+            left = std::move(left).unite(right);
+            break;
+        case '-':
+            left = std::move(left).difference(right);
+            break;
+        default:
+            left = left.symmetricDifference(right);
+            break;
+    }
+}
+
+Set SetEvaluator::parseLiteral() {
+    // Литерал заканчивается на парной закрывающей скобке
+    const std::size_t begin = pos_;
+    std::size_t depth = 0;
+    do {
+        if (input_[pos_] == '{') {
+            ++depth;
+        } else if (input_[pos_] == '}') {
+            --depth;
+        }
+        ++pos_;
+    } while (depth > 0 && pos_ < input_.size());
+    if (depth > 0) {
+        throw std::invalid_argument("Expected '}'");
+    }
+    return Set::deserialize(input_.substr(begin, pos_ - begin));
+}
+
+bool SetEvaluator::consume(char expected) {
+    if (pos_ < input_.size() && input_[pos_] == expected) {
+        ++pos_;
+        return true;
+    }
+    return false;
+}
+
+void SetEvaluator::skipWhitespace() {
+    while (pos_ < input_.size() &&
+           (input_[pos_] == ' ' || input_[pos_] == '\t' || input_[pos_] == '\r' || input_[pos_] == '\n')) {
+        ++pos_;
+    }
+}
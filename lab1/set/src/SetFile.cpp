@@ -0,0 +1,354 @@
+#include "SetFile.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#ifdef SET_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+const std::string_view FILE_MAGIC = "SETF";
+const std::uint8_t FILE_VERSION = 1;
+const std::uint8_t FLAG_COMPRESSED = 0x01;
+const std::uint64_t HEADER_BYTES = 6;
+// Смещения трёх таблиц, число блоков и элементов, FNV-1a таблиц, магия
+const std::uint64_t FOOTER_BYTES = 6 * 8 + 4;
+const std::uint64_t CHUNK_ENTRY = 32;
+const std::uint64_t ELEMENT_ENTRY = 8;
+const std::uint64_t HASH_ENTRY = 16;
+const std::uint64_t NO_CHUNK = UINT64_MAX;
+
+std::uint64_t mix(std::uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    return value ^ (value >> 33);
+}
+
+// Как ElementHash, не зависит от порядка и повторов детей, но строится по
+// тексту атомов, а не по их номерам, и потому одинаков во всех процессах.
+// Узлы считаются снизу вверх явным стеком; узел опознаётся по адресу
+// массива детей, разделяемые поддеревья считаются один раз.
+std::uint64_t stableHash(const Set::Element& element) {
+    if (element.type == Set::VALUE) return mix(fnv1a64(element.atom.str()));
+    std::unordered_map<const Set::Element*, std::uint64_t> nodes;
+    std::vector<const Set::Subset*> pending{&element.subset};
+    std::vector<std::uint64_t> hashes;
+    while (!pending.empty()) {
+        const Set::Subset& subset = *pending.back();
+        if (nodes.count(subset.begin()) != 0) {
+            pending.pop_back();
+            continue;
+        }
+        bool ready = true;
+        for (const auto& child : subset) {
+            if (child.type == Set::NESTED_SET && nodes.count(child.subset.begin()) == 0) {
+                pending.push_back(&child.subset);
+                ready = false;
+            }
+        }
+        if (!ready) continue;
+        pending.pop_back();
+        hashes.clear();
+        for (const auto& child : subset) {
+            hashes.push_back(child.type == Set::VALUE ? mix(fnv1a64(child.atom.str())) : nodes[child.subset.begin()]);
+        }
+        std::sort(hashes.begin(), hashes.end());
+        hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+        std::uint64_t hash = mix(~std::uint64_t(0));
+        for (std::uint64_t child : hashes) {
+            hash = mix(hash ^ child);
+        }
+        nodes[subset.begin()] = hash;
+    }
+    return nodes[element.subset.begin()];
+}
+
+#ifdef SET_HAVE_ZLIB
+std::string deflate(std::string_view raw) {
+    uLongf size = compressBound(static_cast<uLong>(raw.size()));
+    std::string packed(size, '\0');
+    if (compress2(reinterpret_cast<Bytef*>(&packed[0]), &size, reinterpret_cast<const Bytef*>(raw.data()),
+                  static_cast<uLong>(raw.size()), Z_DEFAULT_COMPRESSION) != Z_OK) {
+        throw std::runtime_error("Cannot compress set file chunk");
+    }
+    packed.resize(size);
+    return packed;
+}
+
+void inflate(std::string_view packed, std::string& raw, std::uint64_t rawSize) {
+    raw.resize(rawSize);
+    uLongf size = static_cast<uLongf>(rawSize);
+    if (uncompress(reinterpret_cast<Bytef*>(&raw[0]), &size, reinterpret_cast<const Bytef*>(packed.data()),
+                   static_cast<uLong>(packed.size())) != Z_OK || size != rawSize) {
+        throw std::invalid_argument("Corrupted set file chunk");
+    }
+}
+#endif
+
+}
+
+void SetFile::write(const Set& set, const std::string& path, bool compress) {
+#ifndef SET_HAVE_ZLIB
+    compress = false;
+#endif
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot open " + path + " for writing");
+    }
+    BinaryWriter header;
+    header.writeBytes(FILE_MAGIC);
+    header.writeByte(FILE_VERSION);
+    header.writeByte(compress ? FLAG_COMPRESSED : 0);
+    out.write(header.buffer().data(), static_cast<std::streamsize>(header.buffer().size()));
+    std::uint64_t offset = HEADER_BYTES;
+
+    BinaryWriter chunkTable;
+    BinaryWriter elementTable;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> hashes;
+    hashes.reserve(set.size());
+    ElementEncoder encoder;
+    BinaryWriter body;
+    std::vector<std::uint64_t> positions;
+    auto flush = [&]() {
+        if (positions.empty()) return;
+        BinaryWriter raw;
+        encoder.writeAtomTable(raw);
+        const std::uint64_t base = raw.buffer().size();
+        raw.writeBytes(body.buffer());
+        if (raw.buffer().size() > UINT32_MAX) {
+            throw std::length_error("Set file chunk is too large");
+        }
+        const std::uint64_t chunk = chunkTable.buffer().size() / CHUNK_ENTRY;
+        for (std::uint64_t position : positions) {
+            elementTable.writeFixed64((chunk << 32) | (base + position));
+        }
+        const std::uint64_t rawSize = raw.buffer().size();
+        std::string stored;
+#ifdef SET_HAVE_ZLIB
+        if (compress) stored = deflate(raw.buffer());
+#endif
+        // Несжимаемый блок хранится как есть: размеры на диске и исходный совпадают
+        if (!compress || stored.size() >= rawSize) stored = raw.take();
+        chunkTable.writeFixed64(offset);
+        chunkTable.writeFixed64(stored.size());
+        chunkTable.writeFixed64(rawSize);
+        chunkTable.writeFixed64(fnv1a64(stored));
+        out.write(stored.data(), static_cast<std::streamsize>(stored.size()));
+        offset += stored.size();
+        encoder = ElementEncoder();
+        body = BinaryWriter();
+        positions.clear();
+    };
+    for (const auto& element : set) {
+        positions.push_back(body.buffer().size());
+        encoder.collect(element);
+        encoder.writeElement(body, element);
+        hashes.emplace_back(stableHash(element), hashes.size());
+        if (body.buffer().size() >= CHUNK_BYTES) flush();
+    }
+    flush();
+
+    std::sort(hashes.begin(), hashes.end());
+    BinaryWriter index;
+    index.writeBytes(chunkTable.buffer());
+    index.writeBytes(elementTable.buffer());
+    for (const auto& entry : hashes) {
+        index.writeFixed64(entry.first);
+        index.writeFixed64(entry.second);
+    }
+    BinaryWriter footer;
+    footer.writeFixed64(offset);
+    footer.writeFixed64(offset + chunkTable.buffer().size());
+    footer.writeFixed64(offset + chunkTable.buffer().size() + elementTable.buffer().size());
+    footer.writeFixed64(chunkTable.buffer().size() / CHUNK_ENTRY);
+    footer.writeFixed64(hashes.size());
+    footer.writeFixed64(fnv1a64(index.buffer()));
+    footer.writeBytes(FILE_MAGIC);
+    out.write(index.buffer().data(), static_cast<std::streamsize>(index.buffer().size()));
+    out.write(footer.buffer().data(), static_cast<std::streamsize>(footer.buffer().size()));
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+SetFile::SetFile(const std::string& path)
+    : file_(path, MappedFile::RANDOM), data_(file_.view()), cachedIndex_(NO_CHUNK) {
+    if (data_.size() < HEADER_BYTES + FOOTER_BYTES || data_.substr(0, FILE_MAGIC.size()) != FILE_MAGIC ||
+        data_.substr(data_.size() - FILE_MAGIC.size()) != FILE_MAGIC) {
+        throw std::invalid_argument("Invalid set file format");
+    }
+    BinaryReader header(data_.substr(FILE_MAGIC.size(), 2));
+    if (header.readByte() != FILE_VERSION) {
+        throw std::invalid_argument("Unsupported set file version");
+    }
+    compressed_ = (header.readByte() & FLAG_COMPRESSED) != 0;
+    const std::uint64_t footer = data_.size() - FOOTER_BYTES;
+    BinaryReader in(data_.substr(footer));
+    chunkTable_ = in.readFixed64();
+    elementTable_ = in.readFixed64();
+    hashTable_ = in.readFixed64();
+    chunks_ = in.readFixed64();
+    elements_ = in.readFixed64();
+    indexHash_ = in.readFixed64();
+    // Таблицы идут подряд от конца блоков до завершающего заголовка;
+    // числа сравниваются до умножения, чтобы не переполниться
+    if (chunkTable_ < HEADER_BYTES || chunkTable_ > footer ||
+        chunks_ > (footer - chunkTable_) / CHUNK_ENTRY ||
+        elementTable_ != chunkTable_ + chunks_ * CHUNK_ENTRY ||
+        elements_ > (footer - elementTable_) / (ELEMENT_ENTRY + HASH_ENTRY) ||
+        hashTable_ != elementTable_ + elements_ * ELEMENT_ENTRY ||
+        hashTable_ + elements_ * HASH_ENTRY != footer) {
+        throw std::invalid_argument("Corrupted set file index");
+    }
+}
+
+std::size_t SetFile::size() const {
+    return static_cast<std::size_t>(elements_);
+}
+
+bool SetFile::empty() const {
+    return elements_ == 0;
+}
+
+std::size_t SetFile::chunkCount() const {
+    return static_cast<std::size_t>(chunks_);
+}
+
+bool SetFile::compressed() const {
+    return compressed_;
+}
+
+bool SetFile::contains(const Set::Element& element) const {
+    const std::uint64_t hash = stableHash(element);
+    std::uint64_t low = 0;
+    std::uint64_t high = elements_;
+    while (low < high) {
+        const std::uint64_t middle = low + (high - low) / 2;
+        if (fixed64(hashTable_ + middle * HASH_ENTRY) < hash) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    for (; low < elements_ && fixed64(hashTable_ + low * HASH_ENTRY) == hash; ++low) {
+        const std::uint64_t number = fixed64(hashTable_ + low * HASH_ENTRY + 8);
+        if (number >= elements_) {
+            throw std::invalid_argument("Corrupted set file index");
+        }
+        if (decode(number) == element) return true;
+    }
+    return false;
+}
+
+Set::Element SetFile::fetch(std::size_t index) const {
+    if (index >= elements_) {
+        throw std::out_of_range("Element index out of range");
+    }
+    return decode(index);
+}
+
+void SetFile::forEach(const std::function<void(const Set::Element&)>& visitor) const {
+    // Блоки распаковываются по очереди в свой буфер, кеш не затрагивается
+    Chunk chunk;
+    std::uint64_t current = NO_CHUNK;
+    for (std::uint64_t i = 0; i < elements_; ++i) {
+        const std::uint64_t entry = fixed64(elementTable_ + i * ELEMENT_ENTRY);
+        if (entry >> 32 != current) {
+            current = entry >> 32;
+            unpack(current, chunk);
+        }
+        const std::uint64_t offset = entry & UINT32_MAX;
+        if (offset >= chunk.raw.size()) {
+            throw std::invalid_argument("Corrupted set file index");
+        }
+        BinaryReader in(std::string_view(chunk.raw).substr(offset));
+        visitor(chunk.decoder.readElement(in));
+    }
+}
+
+Set SetFile::load() const {
+    std::vector<Set::Element> items;
+    items.reserve(static_cast<std::size_t>(elements_));
+    forEach([&items](const Set::Element& element) { items.push_back(element); });
+    return Set(std::move(items));
+}
+
+void SetFile::verify() const {
+    const std::uint64_t footer = data_.size() - FOOTER_BYTES;
+    if (fnv1a64(data_.substr(chunkTable_, footer - chunkTable_)) != indexHash_) {
+        throw std::invalid_argument("Set file index checksum mismatch");
+    }
+    Chunk chunk;
+    for (std::uint64_t i = 0; i < chunks_; ++i) {
+        const std::uint64_t entry = chunkTable_ + i * CHUNK_ENTRY;
+        const std::uint64_t offset = fixed64(entry);
+        const std::uint64_t stored = fixed64(entry + 8);
+        if (offset > chunkTable_ || stored > chunkTable_ - offset ||
+            fnv1a64(data_.substr(offset, stored)) != fixed64(entry + 24)) {
+            throw std::invalid_argument("Set file chunk checksum mismatch");
+        }
+        unpack(i, chunk);
+    }
+    std::uint64_t previous = 0;
+    for (std::uint64_t i = 0; i < elements_; ++i) {
+        const std::uint64_t hash = fixed64(hashTable_ + i * HASH_ENTRY);
+        if (hash < previous || fixed64(hashTable_ + i * HASH_ENTRY + 8) >= elements_ ||
+            fixed64(elementTable_ + i * ELEMENT_ENTRY) >> 32 >= chunks_) {
+            throw std::invalid_argument("Corrupted set file index");
+        }
+        previous = hash;
+    }
+}
+
+std::uint64_t SetFile::fixed64(std::uint64_t offset) const {
+    BinaryReader in(data_.substr(offset, 8));
+    return in.readFixed64();
+}
+
+void SetFile::unpack(std::uint64_t index, Chunk& chunk) const {
+    if (index >= chunks_) {
+        throw std::invalid_argument("Corrupted set file index");
+    }
+    const std::uint64_t entry = chunkTable_ + index * CHUNK_ENTRY;
+    const std::uint64_t offset = fixed64(entry);
+    const std::uint64_t stored = fixed64(entry + 8);
+    const std::uint64_t rawSize = fixed64(entry + 16);
+    if (offset < HEADER_BYTES || offset > chunkTable_ || stored > chunkTable_ - offset || rawSize > UINT32_MAX) {
+        throw std::invalid_argument("Corrupted set file chunk");
+    }
+    const std::string_view bytes = data_.substr(offset, stored);
+    if (stored == rawSize) {
+        chunk.raw.assign(bytes.data(), bytes.size());
+    } else {
+#ifdef SET_HAVE_ZLIB
+        inflate(bytes, chunk.raw, rawSize);
+#else
+        throw std::runtime_error("Set file chunk is compressed, but zlib support is disabled");
+#endif
+    }
+    BinaryReader in(chunk.raw);
+    chunk.decoder.readAtomTable(in);
+}
+
+Set::Element SetFile::decode(std::uint64_t index) const {
+    const std::uint64_t entry = fixed64(elementTable_ + index * ELEMENT_ENTRY);
+    const std::uint64_t offset = entry & UINT32_MAX;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cachedIndex_ != entry >> 32) {
+        cachedIndex_ = NO_CHUNK;
+        unpack(entry >> 32, cached_);
+        cachedIndex_ = entry >> 32;
+    }
+    if (offset >= cached_.raw.size()) {
+        throw std::invalid_argument("Corrupted set file index");
+    }
+    BinaryReader in(std::string_view(cached_.raw).substr(offset));
+    return cached_.decoder.readElement(in);
+}
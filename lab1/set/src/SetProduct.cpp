@@ -0,0 +1,135 @@
+#include "SetProduct.h"
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+SetProduct::const_iterator::const_iterator(const SetProduct* product, std::size_t index)
+    : product_(product), index_(index) {}
+
+Set::Element SetProduct::const_iterator::operator*() const {
+    return (*product_)[index_];
+}
+
+SetProduct::const_iterator& SetProduct::const_iterator::operator++() {
+    ++index_;
+    return *this;
+}
+
+SetProduct::const_iterator SetProduct::const_iterator::operator++(int) {
+    const_iterator previous = *this;
+    ++index_;
+    return previous;
+}
+
+bool SetProduct::const_iterator::operator==(const const_iterator& other) const {
+    return product_ == other.product_ && index_ == other.index_;
+}
+
+bool SetProduct::const_iterator::operator!=(const const_iterator& other) const {
+    return !(*this == other);
+}
+
+SetProduct::SetProduct(const Set& left, const Set& right) : left_(&left), right_(&right) {}
+
+SetProduct Set::product(const Set& other) const & {
+    return SetProduct(*this, other);
+}
+
+std::size_t SetProduct::size() const {
+    const std::size_t rows = left_->size();
+    const std::size_t columns = right_->size();
+    if (rows != 0 && columns > std::numeric_limits<std::size_t>::max() / rows) {
+        throw std::overflow_error("Product size overflow");
+    }
+    return rows * columns;
+}
+
+bool SetProduct::empty() const {
+    return left_->isEmpty() || right_->isEmpty();
+}
+
+Set::Element SetProduct::operator[](std::size_t index) const {
+    const std::size_t columns = right_->size();
+    // Пустой правый множитель: пар нет, делить на ноль нельзя
+    if (columns == 0) {
+        throw std::out_of_range("Pair index out of range");
+    }
+    return pair(*(left_->begin() + static_cast<std::ptrdiff_t>(index / columns)),
+                *(right_->begin() + static_cast<std::ptrdiff_t>(index % columns)));
+}
+
+Set::Element SetProduct::at(std::size_t index) const {
+    if (index >= size()) {
+        throw std::out_of_range("Pair index out of range");
+    }
+    return (*this)[index];
+}
+
+SetProduct::const_iterator SetProduct::begin() const {
+    return const_iterator(this, 0);
+}
+
+SetProduct::const_iterator SetProduct::end() const {
+    return const_iterator(this, size());
+}
+
+bool SetProduct::contains(const Set::Element& element) const {
+    Set::Element first;
+    Set::Element second;
+    return unpair(element, first, second) && left_->contains(first) && right_->contains(second);
+}
+
+Set SetProduct::evaluate() const {
+    std::vector<Set::Element> pairs;
+    pairs.reserve(size());
+    forEach([&pairs](Set::Element pair) { pairs.push_back(std::move(pair)); });
+    return Set(std::move(pairs));
+}
+
+Set::Element SetProduct::pair(const Set::Element& first, const Set::Element& second) {
+    std::vector<Set::Element> items{Set::Element(std::vector<Set::Element>{first})};
+    if (second != first) {
+        items.emplace_back(std::vector<Set::Element>{first, second});
+    }
+    return Set::Element(std::move(items));
+}
+
+bool SetProduct::unpair(const Set::Element& pair, Set::Element& first, Set::Element& second) {
+    if (pair.type != Set::NESTED_SET) return false;
+    // Повторы детей допустимы: {{a}, {a}} — та же пара (a, a)
+    std::vector<const Set::Element*> parts;
+    for (const auto& child : pair.subset) {
+        if (child.type != Set::NESTED_SET || child.subset.empty()) return false;
+        bool seen = false;
+        for (const Set::Element* part : parts) {
+            if (*part == child) seen = true;
+        }
+        if (!seen) parts.push_back(&child);
+    }
+    if (parts.size() == 1) {
+        const Set::Subset& only = parts[0]->subset;
+        for (const auto& item : only) {
+            if (item != only[0]) return false;
+        }
+        first = only[0];
+        second = only[0];
+        return true;
+    }
+    if (parts.size() != 2) return false;
+    // Одна из частей — {a}, другая — {a, b}
+    const Set::Subset* single = &parts[0]->subset;
+    const Set::Subset* both = &parts[1]->subset;
+    if (single->size() > both->size()) std::swap(single, both);
+    if (single->size() != 1 || both->size() != 2) return false;
+    const Set::Element& a = (*single)[0];
+    if ((*both)[0] == a) {
+        second = (*both)[1];
+    } else if ((*both)[1] == a) {
+        second = (*both)[0];
+    } else {
+        return false;
+    }
+    first = a;
+    return true;
+}
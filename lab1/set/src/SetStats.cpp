@@ -0,0 +1,185 @@
+#include "SetStats.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::mutex statsMutex;
+std::map<std::string, OperationStats> statsTable;
+
+// Счётчики текущей внешней операции потока; в задаче пула — операции
+// потока, запустившего задачу
+thread_local OperationStats current;
+thread_local unsigned depth = 0;
+thread_local SetStats::Scope* activeScope = nullptr;
+
+std::atomic<std::uint64_t> heapAllocationCount{0};
+std::atomic<std::uint64_t> heapByteCount{0};
+
+void add(OperationStats& total, const OperationStats& part) {
+    total.comparisons += part.comparisons;
+    total.allocations += part.allocations;
+    total.bytesCopied += part.bytesCopied;
+}
+
+}
+
+std::map<std::string, OperationStats> SetStats::snapshot() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return statsTable;
+}
+
+void SetStats::reset() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    statsTable.clear();
+}
+
+SetStats::Scope::Scope(const char* operation) : operation_(operation) {
+    if (depth++ == 0) {
+        current = OperationStats();
+        activeScope = this;
+    }
+}
+
+SetStats::Scope::~Scope() {
+    if (--depth != 0) return;
+    activeScope = nullptr;
+    OperationStats total = current;
+    {
+        // Все задачи пула к этому моменту завершены
+        std::lock_guard<std::mutex> lock(mutex_);
+        add(total, workers_);
+    }
+    std::lock_guard<std::mutex> lock(statsMutex);
+    OperationStats& entry = statsTable[operation_];
+    ++entry.calls;
+    add(entry, total);
+}
+
+SetStats::Scope* SetStats::Scope::active() {
+    return activeScope;
+}
+
+SetStats::Attach::Attach(Scope* scope) : scope_(scope), savedActive_(nullptr), savedDepth_(0) {
+    // Поток, который сам ведёт эту операцию, считает в неё напрямую
+    if (scope_ == nullptr || scope_ == activeScope) {
+        scope_ = nullptr;
+        return;
+    }
+    savedActive_ = activeScope;
+    savedDepth_ = depth;
+    saved_ = current;
+    current = OperationStats();
+    activeScope = scope_;
+    depth = 1;
+}
+
+SetStats::Attach::~Attach() {
+    if (scope_ == nullptr) return;
+    {
+        std::lock_guard<std::mutex> lock(scope_->mutex_);
+        add(scope_->workers_, current);
+    }
+    current = saved_;
+    depth = savedDepth_;
+    activeScope = savedActive_;
+}
+
+void SetStats::count(std::uint64_t OperationStats::*field, std::uint64_t amount) {
+    // Вне открытых операций счётчики не накапливаются
+    if (depth != 0) current.*field += amount;
+}
+
+std::uint64_t SetStats::heapAllocations() {
+    return heapAllocationCount.load(std::memory_order_relaxed);
+}
+
+std::uint64_t SetStats::heapBytes() {
+    return heapByteCount.load(std::memory_order_relaxed);
+}
+
+void SetStats::resetHeap() {
+    heapAllocationCount.store(0, std::memory_order_relaxed);
+    heapByteCount.store(0, std::memory_order_relaxed);
+}
+
+#ifdef SET_ENABLE_STATS
+// Замена operator new учитывает все выделения кучи внутри операций:
+// буферы контейнеров, хеш-индексы, фильтры, узлы из new_delete_resource
+namespace {
+
+void noteAllocation(std::size_t size) {
+    heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    heapByteCount.fetch_add(size, std::memory_order_relaxed);
+    if (depth != 0) ++current.allocations;
+}
+
+void* countedAllocate(std::size_t size) {
+    noteAllocation(size);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* countedAllocateAligned(std::size_t size, std::align_val_t alignment) {
+    noteAllocation(size);
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    const std::size_t rounded = (size + align - 1) / align * align;
+    if (void* memory = std::aligned_alloc(align, rounded == 0 ? align : rounded)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+}
+
+void* operator new(std::size_t size) {
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return countedAllocate(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return countedAllocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return countedAllocateAligned(size, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+#endif
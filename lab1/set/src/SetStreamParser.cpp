@@ -0,0 +1,208 @@
+#include "SetStreamParser.h"
+#include "MappedFile.h"
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <unistd.h>
+
+namespace {
+
+bool isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool isTokenChar(char c) {
+    unsigned char uc = static_cast<unsigned char>(c);
+    return std::isdigit(uc) || std::isalpha(uc) || c == '_';
+}
+
+}
+
+SetStreamParser::SetStreamParser() : state_(BEFORE_ROOT) {}
+
+SetStreamParser::SetStreamParser(ElementHandler handler)
+    : state_(BEFORE_ROOT), handler_(std::move(handler)) {}
+
+void SetStreamParser::feed(std::string_view chunk) {
+    for (char c : chunk) {
+        consume(c);
+    }
+}
+
+void SetStreamParser::finish() {
+    if (state_ == BEFORE_ROOT) {
+        throw std::invalid_argument("Invalid set format");
+    }
+    if (state_ != DONE) {
+        throw std::invalid_argument("Expected '}'");
+    }
+}
+
+bool SetStreamParser::isFinished() const {
+    return state_ == DONE;
+}
+
+std::size_t SetStreamParser::depth() const {
+    return stack_.size();
+}
+
+Set SetStreamParser::takeSet() {
+    finish();
+    return std::move(result_);
+}
+
+void SetStreamParser::consume(char c) {
+    switch (state_) {
+        case BEFORE_ROOT:
+            if (isWhitespace(c)) return;
+            if (c != '{') throw std::invalid_argument("Invalid set format");
+            openGroup();
+            return;
+        case EXPECT_ELEMENT:
+            if (isWhitespace(c)) return;
+            if (c == '}') {
+                closeGroup();
+            } else if (c == '{') {
+                openGroup();
+            } else if (c == ',') {
+                // Пустой токен, как и в Set::parseToken
+                finishToken();
+            } else {
+                state_ = IN_TOKEN;
+                consume(c);
+            }
+            return;
+        case IN_TOKEN:
+            if (isWhitespace(c)) return;
+            if (c == ',') {
+                finishToken();
+                state_ = EXPECT_ELEMENT;
+            } else if (c == '}') {
+                finishToken();
+                closeGroup();
+            } else if (c == '{') {
+                throw std::invalid_argument("Unexpected '{' inside token");
+            } else if (!isTokenChar(c)) {
+                throw std::invalid_argument("Invalid character: " + std::string(1, c));
+            } else {
+                token_ += c;
+            }
+            return;
+        case AFTER_ELEMENT:
+            if (isWhitespace(c)) return;
+            if (c == ',') {
+                state_ = EXPECT_ELEMENT;
+            } else if (c == '}') {
+                closeGroup();
+            } else {
+                throw std::invalid_argument("Expected ',' or '}'");
+            }
+            return;
+        case DONE:
+            if (!isWhitespace(c)) {
+                throw std::invalid_argument("Unexpected characters at the end");
+            }
+            return;
+    }
+}
+
+void SetStreamParser::openGroup() {
+    stack_.emplace_back();
+    state_ = EXPECT_ELEMENT;
+}
+
+void SetStreamParser::closeGroup() {
+    if (stack_.size() == 1) {
+        stack_.pop_back();
+        state_ = DONE;
+        return;
+    }
+    Set::Element group(std::move(stack_.back()));
+    stack_.pop_back();
+    emit(std::move(group));
+    state_ = AFTER_ELEMENT;
+}
+
+void SetStreamParser::finishToken() {
+    // Буфер токена переиспользуется, копируется только готовый атом
+    emit(Set::Element(token_));
+    token_.clear();
+}
+
+void SetStreamParser::emit(Set::Element&& element) {
+    if (stack_.size() > 1) {
+        stack_.back().push_back(std::move(element));
+    } else if (handler_) {
+        handler_(std::move(element));
+    } else {
+        result_.insert(std::move(element));
+    }
+}
+
+void SetStreamParser::pump(std::istream& is, std::size_t chunkSize) {
+    std::vector<char> buffer(chunkSize);
+    while (is) {
+        is.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        feed(std::string_view(buffer.data(), static_cast<std::size_t>(is.gcount())));
+    }
+    finish();
+}
+
+void SetStreamParser::pumpFd(int fd, std::size_t chunkSize) {
+    std::vector<char> buffer(chunkSize);
+    while (true) {
+        ssize_t count = ::read(fd, buffer.data(), buffer.size());
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("Read failed: ") + std::strerror(errno));
+        }
+        if (count == 0) break;
+        feed(std::string_view(buffer.data(), static_cast<std::size_t>(count)));
+    }
+    finish();
+}
+
+void SetStreamParser::pumpFile(const std::string& path, std::size_t chunkSize) {
+    MappedFile file(path);
+    std::string_view data = file.view();
+    for (std::size_t offset = 0; offset < data.size(); offset += chunkSize) {
+        feed(data.substr(offset, chunkSize));
+        file.release(offset + chunkSize);
+    }
+    finish();
+}
+
+Set SetStreamParser::read(std::istream& is, std::size_t chunkSize) {
+    SetStreamParser parser;
+    parser.pump(is, chunkSize);
+    return parser.takeSet();
+}
+
+Set SetStreamParser::readFd(int fd, std::size_t chunkSize) {
+    SetStreamParser parser;
+    parser.pumpFd(fd, chunkSize);
+    return parser.takeSet();
+}
+
+Set SetStreamParser::readFile(const std::string& path, std::size_t chunkSize) {
+    SetStreamParser parser;
+    parser.pumpFile(path, chunkSize);
+    return parser.takeSet();
+}
+
+void SetStreamParser::stream(std::istream& is, ElementHandler handler, std::size_t chunkSize) {
+    SetStreamParser parser(std::move(handler));
+    parser.pump(is, chunkSize);
+}
+
+void SetStreamParser::streamFd(int fd, ElementHandler handler, std::size_t chunkSize) {
+    SetStreamParser parser(std::move(handler));
+    parser.pumpFd(fd, chunkSize);
+}
+
+void SetStreamParser::streamFile(const std::string& path, ElementHandler handler, std::size_t chunkSize) {
+    SetStreamParser parser(std::move(handler));
+    parser.pumpFile(path, chunkSize);
+}
@@ -0,0 +1,162 @@
+#include "StructuralScanner.h"
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SET_SCANNER_X86 1
+#endif
+
+namespace {
+
+bool isStructural(unsigned char c) {
+    return c == '{' || c == '}' || c == ',';
+}
+
+bool isAllowed(unsigned char c) {
+    return isStructural(c) || c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '_' ||
+           (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+}
+
+void scanScalar(std::string_view input, std::size_t from, StructuralIndex& index) {
+    for (std::size_t i = from; i < input.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(input[i]);
+        if (isStructural(c)) {
+            index.positions.push_back(static_cast<std::uint32_t>(i));
+        } else if (!isAllowed(c)) {
+            index.valid = false;
+        }
+    }
+}
+
+// Позиции установленных битов маски блока, начинающегося с base
+void appendBits(std::uint32_t mask, std::size_t base, StructuralIndex& index) {
+    while (mask != 0) {
+        index.positions.push_back(static_cast<std::uint32_t>(base + __builtin_ctz(mask)));
+        mask &= mask - 1;
+    }
+}
+
+#ifdef SET_SCANNER_X86
+
+// Сравнения SSE2 знаковые: байты от 0x80 отрицательны и в диапазоны
+// цифр и букв не попадают, поэтому считаются недопустимыми.
+std::size_t scanSse2(std::string_view input, StructuralIndex& index) {
+    const __m128i openBrace = _mm_set1_epi8('{');
+    const __m128i closeBrace = _mm_set1_epi8('}');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i carriage = _mm_set1_epi8('\r');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i underscore = _mm_set1_epi8('_');
+    const __m128i beforeDigit = _mm_set1_epi8('0' - 1);
+    const __m128i afterDigit = _mm_set1_epi8('9' + 1);
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i beforeLetter = _mm_set1_epi8('a' - 1);
+    const __m128i afterLetter = _mm_set1_epi8('z' + 1);
+
+    const char* data = input.data();
+    std::size_t i = 0;
+    __m128i invalid = _mm_setzero_si128();
+    for (; i + 16 <= input.size(); i += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i structural = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, openBrace), _mm_cmpeq_epi8(block, closeBrace)),
+            _mm_cmpeq_epi8(block, comma));
+        const __m128i whitespace = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+            _mm_or_si128(_mm_cmpeq_epi8(block, carriage), _mm_cmpeq_epi8(block, newline)));
+        const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(block, beforeDigit), _mm_cmplt_epi8(block, afterDigit));
+        const __m128i lower = _mm_or_si128(block, caseBit);
+        const __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, beforeLetter), _mm_cmplt_epi8(lower, afterLetter));
+        const __m128i allowed = _mm_or_si128(
+            _mm_or_si128(structural, whitespace),
+            _mm_or_si128(_mm_or_si128(digit, letter), _mm_cmpeq_epi8(block, underscore)));
+        invalid = _mm_or_si128(invalid, _mm_andnot_si128(allowed, _mm_set1_epi8(-1)));
+        appendBits(static_cast<std::uint32_t>(_mm_movemask_epi8(structural)), i, index);
+    }
+    if (_mm_movemask_epi8(invalid) != 0) index.valid = false;
+    return i;
+}
+
+__attribute__((target("avx2")))
+std::size_t scanAvx2(std::string_view input, StructuralIndex& index) {
+    const __m256i openBrace = _mm256_set1_epi8('{');
+    const __m256i closeBrace = _mm256_set1_epi8('}');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i carriage = _mm256_set1_epi8('\r');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i underscore = _mm256_set1_epi8('_');
+    const __m256i beforeDigit = _mm256_set1_epi8('0' - 1);
+    const __m256i afterDigit = _mm256_set1_epi8('9' + 1);
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    const __m256i beforeLetter = _mm256_set1_epi8('a' - 1);
+    const __m256i afterLetter = _mm256_set1_epi8('z' + 1);
+
+    const char* data = input.data();
+    std::size_t i = 0;
+    __m256i invalid = _mm256_setzero_si256();
+    for (; i + 32 <= input.size(); i += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i structural = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, openBrace), _mm256_cmpeq_epi8(block, closeBrace)),
+            _mm256_cmpeq_epi8(block, comma));
+        const __m256i whitespace = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, carriage), _mm256_cmpeq_epi8(block, newline)));
+        const __m256i digit = _mm256_and_si256(
+            _mm256_cmpgt_epi8(block, beforeDigit), _mm256_cmpgt_epi8(afterDigit, block));
+        const __m256i lower = _mm256_or_si256(block, caseBit);
+        const __m256i letter = _mm256_and_si256(
+            _mm256_cmpgt_epi8(lower, beforeLetter), _mm256_cmpgt_epi8(afterLetter, lower));
+        const __m256i allowed = _mm256_or_si256(
+            _mm256_or_si256(structural, whitespace),
+            _mm256_or_si256(_mm256_or_si256(digit, letter), _mm256_cmpeq_epi8(block, underscore)));
+        invalid = _mm256_or_si256(invalid, _mm256_andnot_si256(allowed, _mm256_set1_epi8(-1)));
+        appendBits(static_cast<std::uint32_t>(_mm256_movemask_epi8(structural)), i, index);
+    }
+    if (_mm256_movemask_epi8(invalid) != 0) index.valid = false;
+    return i;
+}
+
+#endif
+
+}
+
+StructuralScanner::Kernel StructuralScanner::best() {
+#ifdef SET_SCANNER_X86
+    static const Kernel kernel = __builtin_cpu_supports("avx2") ? Kernel::AVX2 : Kernel::SSE2;
+    return kernel;
+#else
+    return Kernel::SCALAR;
+#endif
+}
+
+StructuralIndex StructuralScanner::scan(std::string_view input) {
+    return scan(input, best());
+}
+
+StructuralIndex StructuralScanner::scan(std::string_view input, Kernel kernel) {
+    StructuralIndex index;
+    // Позиции хранятся в 32 битах, как в simdjson
+    if (input.size() > std::numeric_limits<std::uint32_t>::max()) {
+        index.valid = false;
+        return index;
+    }
+    // Недоступное на этом процессоре ядро заменяется лучшим из доступных
+    if (kernel == Kernel::AVX2 && best() != Kernel::AVX2) kernel = best();
+    if (kernel == Kernel::SSE2 && best() == Kernel::SCALAR) kernel = Kernel::SCALAR;
+    index.positions.reserve(input.size() / 4);
+    std::size_t done = 0;
+#ifdef SET_SCANNER_X86
+    if (kernel == Kernel::AVX2) {
+        done = scanAvx2(input, index);
+    } else if (kernel == Kernel::SSE2) {
+        done = scanSse2(input, index);
+    }
+#endif
+    scanScalar(input, done, index);
+    return index;
+}
@@ -0,0 +1,113 @@
+#include "SubsetStore.h"
+#include "SetStats.h"
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+SubsetStore::SubsetStore(std::pmr::memory_resource* resource) : resource_(resource) {}
+
+SubsetStore::~SubsetStore() {
+    // Метка снимается до освобождения ссылок: другое хранилище по тому же
+    // адресу не должно счесть эти узлы своими
+    for (const auto& element : canonical_) {
+        element.subset.setStore(nullptr);
+    }
+}
+
+SubsetStore& SubsetStore::global() {
+    static SubsetStore* store = new SubsetStore();
+    return *store;
+}
+
+Set::Subset SubsetStore::intern(const Set::Subset& subset) {
+    if (subset.empty()) return subset;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return canonicalize(subset);
+}
+
+Set::Element SubsetStore::intern(const Set::Element& element) {
+    if (element.type != Set::NESTED_SET) return element;
+    return Set::Element(intern(element.subset));
+}
+
+std::size_t SubsetStore::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return canonical_.size();
+}
+
+std::pmr::memory_resource* SubsetStore::resource() const {
+    return resource_;
+}
+
+Set::Subset SubsetStore::find(const Set::Subset& subset) const {
+    if (subset.store() == this) return subset;
+    auto it = canonical_.find(Set::Element(subset));
+    return it == canonical_.end() ? Set::Subset() : it->subset;
+}
+
+Set::Subset SubsetStore::canonicalize(const Set::Subset& subset) {
+    Set::Subset found = find(subset);
+    if (!found.empty()) return found;
+    // Обход снизу вверх явным стеком: узел регистрируется после детей
+    struct Frame {
+        Set::Subset source;
+        std::vector<Set::Element> children;
+        bool changed;
+    };
+    std::vector<Frame> stack;
+    stack.push_back(Frame{subset, {}, false});
+    while (true) {
+        Frame& frame = stack.back();
+        if (frame.children.size() < frame.source.size()) {
+            const Set::Element& child = frame.source[frame.children.size()];
+            if (child.type != Set::NESTED_SET || child.subset.empty()) {
+                frame.children.push_back(child);
+                continue;
+            }
+            found = find(child.subset);
+            if (found.empty()) {
+                stack.push_back(Frame{child.subset, {}, false});
+                continue;
+            }
+            frame.changed = frame.changed || !found.sharesNodeWith(child.subset);
+            frame.children.emplace_back(std::move(found));
+            continue;
+        }
+        // Узел без изменённых детей из того же ресурса становится
+        // каноническим сам; иначе дети переносятся в новый узел
+        Set::Subset node;
+        if (!frame.changed && frame.source.resource() == resource_ && frame.source.store() == nullptr) {
+            node = frame.source;
+        } else {
+            node = Set::Subset(frame.children, 0, resource_);
+        }
+        node.setStore(this);
+        canonical_.insert(Set::Element(node));
+        stack.pop_back();
+        if (stack.empty()) return node;
+        Frame& parent = stack.back();
+        const Set::Subset& original = parent.source[parent.children.size()].subset;
+        parent.changed = parent.changed || !node.sharesNodeWith(original);
+        parent.children.emplace_back(std::move(node));
+    }
+}
+
+Set Set::powerSet(SubsetStore& store) const {
+    Set result = powerSet();
+    result.internNested(store);
+    return result;
+}
+
+void Set::internNested(SubsetStore& store) {
+    SET_STATS_OPERATION("internNested");
+    if (store.resource() != resource()) {
+        throw std::invalid_argument("Subset store uses a different memory resource");
+    }
+    for (auto& element : storage_) {
+        if (element.type == NESTED_SET && !element.subset.empty()) {
+            element.subset = store.intern(element.subset);
+        }
+    }
+    // Представитель может перечислять детей в другом порядке
+    invalidate();
+}
@@ -0,0 +1,101 @@
+#include "ThreadPool.h"
+#include "SetStats.h"
+#include <algorithm>
+#include <exception>
+#include <memory>
+
+ThreadPool::ThreadPool(std::size_t threads) : stopping_(false) {
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    taskReady_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+std::size_t ThreadPool::size() const {
+    return workers_.size();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            taskReady_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) return;
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t, std::size_t)>& body) {
+    if (count == 0) return;
+    const std::size_t parts = std::min(count, workers_.size() + 1);
+    if (parts == 1) {
+        body(0, count);
+        return;
+    }
+
+    struct Batch {
+        std::size_t remaining;
+        std::exception_ptr error;
+    };
+    auto batch = std::make_shared<Batch>();
+    batch->remaining = parts;
+    // Счётчики задач относятся к операции вызывающего потока
+    SetStats::Scope* stats = SetStats::Scope::active();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::size_t part = 0; part < parts; ++part) {
+            std::size_t begin = count * part / parts;
+            std::size_t end = count * (part + 1) / parts;
+            tasks_.push([this, batch, stats, &body, begin, end]() {
+                std::exception_ptr error;
+                try {
+                    SetStats::Attach attach(stats);
+                    body(begin, end);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (error && !batch->error) batch->error = error;
+                --batch->remaining;
+                taskDone_.notify_all();
+            });
+        }
+    }
+    taskReady_.notify_all();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (batch->remaining > 0) {
+        if (!tasks_.empty()) {
+            std::function<void()> task = std::move(tasks_.front());
+            tasks_.pop();
+            lock.unlock();
+            task();
+            lock.lock();
+        } else {
+            taskDone_.wait(lock);
+        }
+    }
+    if (batch->error) {
+        std::rethrow_exception(batch->error);
+    }
+}
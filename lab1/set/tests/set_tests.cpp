@@ -1,6 +1,29 @@
 #include <gtest/gtest.h>
 #include "Set.h"
+#include "AtomBitSet.h"
+#include "BloomFilter.h"
+#include "PersistentSet.h"
+#include "SetCollection.h"
+#include "SetEvaluator.h"
+#include "SetExpression.h"
+#include "SetFile.h"
+#include "SetProduct.h"
+#include "SetStats.h"
+#include "SetStreamParser.h"
+#include "StructuralScanner.h"
+#include "SubsetStore.h"
+#include "ThreadPool.h"
+#include "../benchmarks/allocation_counter.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
 #include <sstream>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <fcntl.h>
+#include <unistd.h>
 
 class SetTest : public ::testing::Test {
 protected:
@@ -64,6 +87,21 @@ TEST_F(SetTest, SelfAssignment) {
     EXPECT_EQ(set.size(), 3);
 }
 
+TEST_F(SetTest, MoveConstructor) {
+    Set source("{a, {b, c}}");
+    Set moved(std::move(source));
+    EXPECT_EQ(moved.size(), 2);
+    EXPECT_TRUE(source.isEmpty());
+}
+
+TEST_F(SetTest, MoveAssignment) {
+    Set target("{x}");
+    Set source("{a, b}");
+    target = std::move(source);
+    EXPECT_EQ(target, Set("{a, b}"));
+    EXPECT_TRUE(source.isEmpty());
+}
+
 // --- Методы добавления/удаления ---
 TEST_F(SetTest, InsertElement) {
     Set set = emptySet;
@@ -95,6 +133,17 @@ TEST_F(SetTest, InsertDuplicateNested) {
     EXPECT_EQ(set.size(), initial);
 }
 
+TEST_F(SetTest, InsertRvalueAndEmplace) {
+    Set set;
+    Set::Element nested(std::vector<Set::Element>{Set::Element("x")});
+    set.insert(std::move(nested));
+    set.emplace("y");
+    set.emplace(std::string("y"));
+    set.emplace(std::vector<Set::Element>{Set::Element("x")});
+    EXPECT_EQ(set.size(), 2);
+    EXPECT_TRUE(set.has(Set::Element("y")));
+}
+
 TEST_F(SetTest, EraseElement) {
     Set set = simpleSet;
     set.erase(Set::Element("b"));
@@ -166,12 +215,30 @@ TEST_F(SetTest, SelfDifference) {
     EXPECT_TRUE(simpleSetTwo.has(Set::Element("e")));
 }
 
+TEST_F(SetTest, RvalueAlgebraMatchesCopies) {
+    Set expected = simpleSet.unite(simpleSetTwo).intersect(nestedSetTwo).difference(emptySet);
+    Set chained = Set(simpleSet).unite(simpleSetTwo).intersect(nestedSetTwo).difference(emptySet);
+    EXPECT_EQ(chained, expected);
+    EXPECT_EQ(Set(simpleSetTwo).difference(simpleSet), simpleSetTwo.difference(simpleSet));
+    EXPECT_EQ(Set(simpleSet).intersect(simpleSetTwo), simpleSet.intersect(simpleSetTwo));
+    EXPECT_EQ(simpleSet.size(), 3);
+}
+
 TEST_F(SetTest, HasMethod) {
     Set set("{p, q}");
     EXPECT_TRUE(set.has(Set::Element("p")));
     EXPECT_FALSE(set.has(Set::Element("r")));
 }
 
+TEST_F(SetTest, IterateElements) {
+    std::size_t count = 0;
+    for (const auto& element : simpleSet) {
+        EXPECT_TRUE(simpleSet.has(element));
+        ++count;
+    }
+    EXPECT_EQ(count, simpleSet.size());
+}
+
 TEST_F(SetTest, SerializeEmpty) {
     Set set;
     EXPECT_EQ(set.serialize(), "{}");
@@ -238,6 +305,26 @@ TEST(SetParsingTest, UnexpectedBrace) {
     EXPECT_THROW(Set("{a, b{c}"), std::invalid_argument);
 }
 
+TEST(SetParsingTest, WhitespaceInsideToken) {
+    Set set(" {\tab c ,\n{ d e } } ");
+    EXPECT_EQ(set.size(), 2);
+    EXPECT_TRUE(set.has(Set::Element("abc")));
+    EXPECT_TRUE(set.has(Set::Element(std::vector<Set::Element>{Set::Element("de")})));
+}
+
+TEST(SetParsingTest, UnterminatedNestedGroup) {
+    EXPECT_THROW(Set("{{a}"), std::invalid_argument);
+    EXPECT_THROW(Set("{a}}"), std::invalid_argument);
+    EXPECT_THROW(Set("{{a}b}"), std::invalid_argument);
+}
+
+TEST(SetParsingTest, DeserializeFromStringView) {
+    std::string buffer = "prefix{a, {b}}suffix";
+    Set set = Set::deserialize(std::string_view(buffer).substr(6, 8));
+    EXPECT_EQ(set.size(), 2);
+    EXPECT_EQ(set.serialize(), "{a, {b}}");
+}
+
 class SetComplexTest : public ::testing::Test {};
 
 TEST(SetComplexTest, DeepNesting) {
@@ -279,6 +366,73 @@ TEST(ElementTest, Equality) {
     EXPECT_FALSE(a == c);
 }
 
+TEST(ElementTest, CompactLayout) {
+    EXPECT_LE(sizeof(Set::Element), 16u);
+}
+
+TEST(ElementTest, AtomsAreInterned) {
+    Set::Element a("interned_atom");
+    Set::Element b(std::string("interned_") + "atom");
+    EXPECT_EQ(a.atom.id(), b.atom.id());
+    EXPECT_EQ(a.atom, std::string("interned_atom"));
+    EXPECT_NE(a.atom, "other");
+    EXPECT_EQ(a.atom.size(), 13u);
+    EXPECT_TRUE(Set::Element().atom.empty());
+}
+
+TEST(ElementTest, EpochReclaimsAtoms) {
+    AtomTable& table = AtomTable::instance();
+    std::vector<Atom> before;
+    for (int i = 0; i < 3000; ++i) {
+        before.emplace_back("epoch_before_" + std::to_string(i));
+    }
+    const std::size_t size = table.size();
+    {
+        AtomTable::Epoch epoch;
+        for (int i = 0; i < 10000; ++i) {
+            EXPECT_EQ(Atom("epoch_inner_" + std::to_string(i)).id(), size + i);
+        }
+        EXPECT_EQ(table.size(), size + 10000);
+    }
+    EXPECT_EQ(table.size(), size);
+    // Атомы до области находятся по прежним номерам, номера области свободны
+    for (int i = 0; i < 3000; ++i) {
+        EXPECT_EQ(Atom("epoch_before_" + std::to_string(i)).id(), before[i].id());
+        EXPECT_EQ(before[i], "epoch_before_" + std::to_string(i));
+    }
+    EXPECT_EQ(table.size(), size);
+    EXPECT_EQ(Atom("epoch_inner_5000").id(), size);
+}
+
+TEST(ElementTest, CopiesShareNestedNode) {
+    Set::Element nested({Set::Element("x"), Set::Element("y")});
+    Set::Element copy = nested;
+    EXPECT_TRUE(copy.subset.sharesNodeWith(nested.subset));
+    EXPECT_EQ(copy, nested);
+    ASSERT_EQ(copy.subset.size(), 2u);
+    EXPECT_EQ(copy.subset[1].atom, "y");
+    Set::Element empty(std::vector<Set::Element>{});
+    EXPECT_TRUE(empty.subset.empty());
+    EXPECT_EQ(empty.subset.begin(), empty.subset.end());
+}
+
+TEST(ElementTest, ConcurrentInterning) {
+    std::vector<std::thread> threads;
+    std::vector<std::vector<std::uint32_t>> ids(4);
+    for (std::size_t t = 0; t < ids.size(); ++t) {
+        threads.emplace_back([&ids, t]() {
+            for (int i = 0; i < 2000; ++i) {
+                ids[t].push_back(Atom("concurrent_" + std::to_string(i)).id());
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    for (std::size_t t = 1; t < ids.size(); ++t) {
+        EXPECT_EQ(ids[t], ids[0]);
+    }
+    EXPECT_EQ(Atom("concurrent_1999").str(), "concurrent_1999");
+}
+
 class SetDeserializeTest : public ::testing::Test {};
 
 TEST(SetDeserializeTest, RoundTrip) {
@@ -307,6 +461,1508 @@ TEST_F(SetTest, StreamInput) {
     EXPECT_TRUE(set.has(Set::Element("c")));
 }
 
+// --- Ленивые выражения ---
+class SetExpressionTest : public ::testing::Test {
+protected:
+    Set a{"{a, b, c, {x, y}}"};
+    Set b{"{c, d, {y, x}, e}"};
+    Set c{"{a, c, e, {x, y}, f}"};
+    Set d{"{e}"};
+};
+
+TEST(SetHashTest, ConsistentWithEquality) {
+    Set::ElementHash hash;
+    Set::Element xy(std::vector<Set::Element>{Set::Element("x"), Set::Element("y")});
+    Set::Element yxx(std::vector<Set::Element>{Set::Element("y"), Set::Element("x"), Set::Element("x")});
+    EXPECT_EQ(xy, yxx);
+    EXPECT_EQ(hash(xy), hash(yxx));
+    EXPECT_NE(hash(Set::Element("x")), hash(Set::Element("y")));
+    EXPECT_NE(hash(Set::Element("x")), hash(Set::Element(std::vector<Set::Element>{Set::Element("x")})));
+}
+
+TEST_F(SetExpressionTest, MatchesEagerAlgebra) {
+    Set fused = (lazy(a) | b) & (lazy(c) - d);
+    EXPECT_EQ(fused, a.unite(b).intersect(c.difference(d)));
+    Set chain = ((lazy(a) | b) & c) - d;
+    EXPECT_EQ(chain, a.unite(b).intersect(c).difference(d));
+    Set symmetric = lazy(a) ^ b;
+    EXPECT_EQ(symmetric, a.difference(b).unite(b.difference(a)));
+}
+
+TEST_F(SetExpressionTest, AssignAndIterate) {
+    Set result;
+    result = lazy(a) & b;
+    EXPECT_EQ(result, a.intersect(b));
+    std::size_t visited = 0;
+    (lazy(a) | b | c).forEach([&](const Set::Element& element) {
+        EXPECT_TRUE(a.has(element) || b.has(element) || c.has(element));
+        ++visited;
+    });
+    EXPECT_EQ(visited, a.unite(b).unite(c).size());
+    EXPECT_EQ((lazy(a) - a).size(), 0u);
+}
+
+TEST_F(SetExpressionTest, SetOnTheLeft) {
+    Set result = a - (lazy(b) | c);
+    EXPECT_EQ(result, a.difference(b.unite(c)));
+}
+
+template <class Left, class Right, class = void>
+struct HasLazyUnion : std::false_type {};
+template <class Left, class Right>
+struct HasLazyUnion<Left, Right, std::void_t<decltype(std::declval<Left>() | std::declval<Right>())>>
+    : std::true_type {};
+
+template <class Operand, class = void>
+struct HasLazy : std::false_type {};
+template <class Operand>
+struct HasLazy<Operand, std::void_t<decltype(lazy(std::declval<Operand>()))>> : std::true_type {};
+
+TEST_F(SetExpressionTest, TemporaryOperandsRejected) {
+    static_assert(HasLazy<const Set&>::value, "lvalue operand");
+    static_assert(!HasLazy<Set>::value, "temporary operand");
+    static_assert(HasLazyUnion<SetOperand, const Set&>::value, "lvalue operand");
+    static_assert(HasLazyUnion<const Set&, SetOperand>::value, "lvalue operand");
+    static_assert(!HasLazyUnion<SetOperand, Set>::value, "temporary right operand");
+    static_assert(!HasLazyUnion<Set, SetOperand>::value, "temporary left operand");
+    static_assert(!std::is_constructible<SetOperand, Set>::value, "temporary leaf");
+    // Временные подвыражения хранятся по значению и допустимы
+    const Set result = (lazy(a) | b) & (lazy(c) | d);
+    EXPECT_EQ(result, (a.unite(b)).intersect(c.unite(d)));
+}
+
+TEST_F(SetExpressionTest, ReevaluatesAfterOperandChanges) {
+    const auto expression = lazy(a) | b;
+    const Set before = expression;
+    for (int i = 0; i < 1000; ++i) {
+        a.insert(Set::Element("grown" + std::to_string(i)));
+    }
+    const Set after = expression;
+    EXPECT_EQ(after.size(), before.size() + 1000);
+    EXPECT_EQ(after, a.unite(b));
+    EXPECT_TRUE(after.has(Set::Element("grown999")));
+}
+
+TEST_F(SetExpressionTest, ConcurrentEvaluation) {
+    const auto expression = (lazy(a) | b) & (lazy(c) | d);
+    const Set expected = a.unite(b).intersect(c.unite(d));
+    std::vector<Set> results(4);
+    std::vector<std::thread> threads;
+    for (auto& result : results) {
+        threads.emplace_back([&expression, &result] { result = expression; });
+    }
+    for (auto& thread : threads) thread.join();
+    for (const auto& result : results) EXPECT_EQ(result, expected);
+}
+
+// --- Операции над наборами множеств ---
+class SetBulkAlgebraTest : public ::testing::Test {
+protected:
+    static std::vector<Set> makeSets(std::size_t count, std::size_t size) {
+        std::vector<Set> sets;
+        for (std::size_t k = 0; k < count; ++k) {
+            std::vector<Set::Element> items;
+            for (std::size_t i = 0; i < size; ++i) {
+                items.emplace_back("e" + std::to_string((i * (k + 1)) % (size * 2)));
+            }
+            items.emplace_back(std::vector<Set::Element>{Set::Element("shared")});
+            sets.emplace_back(items);
+        }
+        return sets;
+    }
+};
+
+TEST_F(SetBulkAlgebraTest, MatchesFolding) {
+    std::vector<Set> sets = makeSets(6, 40);
+    Set united = sets[0];
+    Set common = sets[0];
+    for (const Set& set : sets) {
+        united.selfUnite(set);
+        common.selfIntersect(set);
+    }
+    EXPECT_EQ(Set::uniteAll(sets), united);
+    EXPECT_EQ(Set::intersectAll(sets), common);
+    EXPECT_TRUE(Set::intersectAll(sets).has(Set::Element(std::vector<Set::Element>{Set::Element("shared")})));
+}
+
+TEST_F(SetBulkAlgebraTest, EmptyInputs) {
+    std::vector<Set> none;
+    EXPECT_TRUE(Set::uniteAll(none).isEmpty());
+    EXPECT_TRUE(Set::intersectAll(none).isEmpty());
+    std::vector<Set> withEmpty = {Set("{a, b}"), Set()};
+    EXPECT_TRUE(Set::intersectAll(withEmpty).isEmpty());
+    EXPECT_EQ(Set::uniteAll(withEmpty), Set("{a, b}"));
+}
+
+TEST_F(SetBulkAlgebraTest, ParallelMatchesSequential) {
+    std::vector<Set> sets = makeSets(4, Set::PARALLEL_THRESHOLD / 2);
+    EXPECT_EQ(Set::uniteAll(sets, true), Set::uniteAll(sets, false));
+    EXPECT_EQ(Set::intersectAll(sets, true), Set::intersectAll(sets, false));
+    // Порядок элементов, а значит и текст, от параллельности не зависит
+    EXPECT_EQ(Set::uniteAll(sets, true).serialize(), Set::uniteAll(sets, false).serialize());
+    EXPECT_EQ(Set::intersectAll(sets, true).serialize(), Set::intersectAll(sets, false).serialize());
+}
+
+TEST(ThreadPoolTest, ParallelForCoversRange) {
+    ThreadPool pool(4);
+    std::vector<int> hits(1000, 0);
+    pool.parallelFor(hits.size(), [&hits](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) ++hits[i];
+    });
+    EXPECT_EQ(std::count(hits.begin(), hits.end(), 1), 1000);
+    EXPECT_THROW(pool.parallelFor(10, [](std::size_t, std::size_t) { throw std::runtime_error("boom"); }),
+                 std::runtime_error);
+    // Без рабочих потоков диапазон целиком обходит вызывающий поток
+    ThreadPool caller(0);
+    EXPECT_EQ(caller.size(), 0u);
+    const std::thread::id self = std::this_thread::get_id();
+    caller.parallelFor(hits.size(), [&hits, self](std::size_t begin, std::size_t end) {
+        EXPECT_EQ(std::this_thread::get_id(), self);
+        for (std::size_t i = begin; i < end; ++i) ++hits[i];
+    });
+    EXPECT_EQ(std::count(hits.begin(), hits.end(), 2), 1000);
+}
+
+// --- Потоковый разбор ---
+class SetStreamParserTest : public ::testing::Test {};
+
+TEST(SetStreamParserTest, ChunkedInputMatchesParser) {
+    std::string input = "{a, {b, {c, d}}, {}, e, a}";
+    for (std::size_t chunk = 1; chunk <= input.size(); ++chunk) {
+        SetStreamParser parser;
+        for (std::size_t pos = 0; pos < input.size(); pos += chunk) {
+            parser.feed(std::string_view(input).substr(pos, chunk));
+        }
+        EXPECT_EQ(parser.takeSet(), Set(input));
+    }
+}
+
+TEST(SetStreamParserTest, ReadFromStream) {
+    std::stringstream ss("  {x, {y, z}, x_1}  ");
+    Set set = SetStreamParser::read(ss, 4);
+    EXPECT_EQ(set.size(), 3);
+    EXPECT_TRUE(set.has(Set::Element("x_1")));
+}
+
+TEST(SetStreamParserTest, StreamTopLevelElements) {
+    std::stringstream ss("{a, {b, c}, d}");
+    std::vector<Set::Element> seen;
+    SetStreamParser::stream(ss, [&seen](Set::Element&& el) { seen.push_back(std::move(el)); }, 3);
+    ASSERT_EQ(seen.size(), 3);
+    EXPECT_EQ(seen[0], Set::Element("a"));
+    EXPECT_EQ(seen[1], Set::Element(std::vector<Set::Element>{Set::Element("b"), Set::Element("c")}));
+    EXPECT_EQ(seen[2], Set::Element("d"));
+}
+
+TEST(SetStreamParserTest, DepthTracksOpenGroups) {
+    SetStreamParser parser([](Set::Element&&) {});
+    parser.feed("{a, {b, {c");
+    EXPECT_EQ(parser.depth(), 3);
+    parser.feed("}}, d}");
+    EXPECT_EQ(parser.depth(), 0);
+    EXPECT_TRUE(parser.isFinished());
+}
+
+TEST(SetStreamParserTest, ReadFromFileAndDescriptor) {
+    char path[] = "/tmp/set_stream_testXXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    std::string input = "{p, {q, r}, s}";
+    ASSERT_EQ(write(fd, input.data(), input.size()), static_cast<ssize_t>(input.size()));
+    lseek(fd, 0, SEEK_SET);
+    EXPECT_EQ(SetStreamParser::readFd(fd, 2), Set(input));
+    close(fd);
+    EXPECT_EQ(SetStreamParser::readFile(path, 5), Set(input));
+    std::remove(path);
+}
+
+TEST(SetStreamParserTest, InvalidInput) {
+    std::stringstream unterminated("{a, {b}");
+    EXPECT_THROW(SetStreamParser::read(unterminated), std::invalid_argument);
+    std::stringstream trailing("{a} b");
+    EXPECT_THROW(SetStreamParser::read(trailing), std::invalid_argument);
+    std::stringstream badChar("{a, b@c}");
+    EXPECT_THROW(SetStreamParser::read(badChar), std::invalid_argument);
+    std::stringstream empty("   ");
+    EXPECT_THROW(SetStreamParser::read(empty), std::invalid_argument);
+    EXPECT_THROW(SetStreamParser::readFile("/nonexistent/set.txt"), std::runtime_error);
+}
+
+// --- Двоичный формат ---
+class SetBinaryTest : public ::testing::Test {};
+
+TEST(SetBinaryTest, RoundTripMatchesText) {
+    Set set("{a, {b, c, {a}}, {}, d, {b, c}}");
+    for (bool withHash : {true, false}) {
+        Set restored = Set::deserializeBinary(set.serializeBinary(withHash));
+        EXPECT_EQ(restored, set);
+        EXPECT_EQ(restored.serialize(), set.serialize());
+    }
+}
+
+TEST(SetBinaryTest, EmptySet) {
+    Set restored = Set::deserializeBinary(Set().serializeBinary());
+    EXPECT_TRUE(restored.isEmpty());
+}
+
+TEST(SetBinaryTest, AtomsAreStoredOnce) {
+    Set set("{{long_atom_name, x}, {long_atom_name, y}, {long_atom_name, z}}");
+    std::string binary = set.serializeBinary(false);
+    EXPECT_EQ(binary.find("long_atom_name"), binary.rfind("long_atom_name"));
+    EXPECT_LT(binary.size(), set.serialize().size());
+}
+
+TEST(SetBinaryTest, DetectsCorruption) {
+    std::string binary = Set("{a, {b}}").serializeBinary();
+    std::string corrupted = binary;
+    corrupted[corrupted.size() / 2] ^= 0x01;
+    EXPECT_THROW(Set::deserializeBinary(corrupted), std::invalid_argument);
+    EXPECT_THROW(Set::deserializeBinary(binary.substr(0, binary.size() - 3)), std::invalid_argument);
+    EXPECT_THROW(Set::deserializeBinary("{a, b}"), std::invalid_argument);
+    std::string noHash = Set("{a, {b}}").serializeBinary(false);
+    EXPECT_THROW(Set::deserializeBinary(noHash + "x"), std::invalid_argument);
+}
+
+TEST(SetBinaryTest, LoadFromMappedFile) {
+    Set set("{p, {q, r}, s}");
+    char path[] = "/tmp/set_binary_testXXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    std::string binary = set.serializeBinary();
+    ASSERT_EQ(write(fd, binary.data(), binary.size()), static_cast<ssize_t>(binary.size()));
+    close(fd);
+    EXPECT_EQ(Set::loadBinaryFile(path), set);
+    std::remove(path);
+}
+
+// --- Битовые множества атомов ---
+class AtomBitSetTest : public ::testing::Test {
+protected:
+    std::shared_ptr<AtomDictionary> dictionary = std::make_shared<AtomDictionary>();
+};
+
+TEST_F(AtomBitSetTest, ConvertsToAndFromSet) {
+    Set set("{a, b, c}");
+    AtomBitSet bits = AtomBitSet::fromSet(set, dictionary);
+    EXPECT_EQ(bits.size(), 3);
+    EXPECT_TRUE(bits.contains(Set::Element("b")));
+    EXPECT_FALSE(bits.contains("d"));
+    EXPECT_EQ(bits.toSet(), set);
+}
+
+TEST_F(AtomBitSetTest, RejectsNestedElements) {
+    EXPECT_THROW(AtomBitSet::fromSet(Set("{a, {b}}"), dictionary), std::invalid_argument);
+    AtomBitSet bits(dictionary);
+    EXPECT_FALSE(bits.contains(Set::Element(std::vector<Set::Element>{})));
+}
+
+TEST_F(AtomBitSetTest, AlgebraMatchesSet) {
+    Set a("{a, b, c, x1, x2}");
+    Set b("{d, c, a, e, x2}");
+    AtomBitSet bitsA = AtomBitSet::fromSet(a, dictionary);
+    AtomBitSet bitsB = AtomBitSet::fromSet(b, dictionary);
+    EXPECT_EQ(bitsA.unite(bitsB).toSet(), a.unite(b));
+    EXPECT_EQ(bitsA.intersect(bitsB).toSet(), a.intersect(b));
+    EXPECT_EQ(bitsA.difference(bitsB).toSet(), a.difference(b));
+    EXPECT_EQ(bitsB.difference(bitsA).toSet(), b.difference(a));
+}
+
+TEST_F(AtomBitSetTest, OperandsOfDifferentLength) {
+    AtomBitSet small(dictionary);
+    small.insert("a");
+    AtomBitSet large(dictionary);
+    for (int i = 0; i < 200; ++i) large.insert("x" + std::to_string(i));
+    large.insert("a");
+    EXPECT_EQ(small.unite(large).size(), 201);
+    EXPECT_EQ(large.intersect(small).size(), 1);
+    EXPECT_EQ(small.difference(large).size(), 0);
+    EXPECT_EQ(large.difference(small).size(), 200);
+    large.erase("a");
+    EXPECT_NE(small, large);
+    AtomBitSet empty(dictionary);
+    EXPECT_EQ(small.difference(small), empty);
+    EXPECT_TRUE(empty.isEmpty());
+}
+
+TEST_F(AtomBitSetTest, DifferentDictionariesRejected) {
+    AtomBitSet a(dictionary);
+    AtomBitSet b(std::make_shared<AtomDictionary>());
+    EXPECT_THROW(a.unite(b), std::invalid_argument);
+    EXPECT_NE(a, b);
+}
+
+// --- Размещение в memory_resource ---
+TEST(SetArenaTest, ParsedTreeLivesInArena) {
+    std::pmr::monotonic_buffer_resource arena;
+    Set set("{a, {b, {c, d}}, {e}}", &arena);
+    EXPECT_EQ(set.resource(), &arena);
+    EXPECT_EQ(set.serialize(), "{a, {b, {c, d}}, {e}}");
+    for (const auto& element : set) {
+        if (element.type == Set::NESTED_SET) {
+            EXPECT_EQ(element.subset.resource(), &arena);
+        }
+    }
+}
+
+TEST(SetArenaTest, AlgebraUsesLeftOperandResource) {
+    std::pmr::unsynchronized_pool_resource pool;
+    Set left("{a, {x, y}, b}", &pool);
+    Set right("{b, {y, x}, c}");
+    Set united = left.unite(right);
+    EXPECT_EQ(united.resource(), &pool);
+    EXPECT_EQ(united, Set("{a, b, c, {x, y}}"));
+    EXPECT_EQ(left.intersect(right).resource(), &pool);
+    EXPECT_EQ(left.intersect(right), Set("{b, {x, y}}"));
+    EXPECT_EQ(left.difference(right), Set("{a}"));
+    Set power = left.powerSet();
+    EXPECT_EQ(power.resource(), &pool);
+    EXPECT_EQ(power.size(), 8u);
+}
+
+TEST(SetArenaTest, CopiesLeaveTheArena) {
+    Set copy;
+    {
+        std::pmr::monotonic_buffer_resource arena;
+        Set set = Set::deserialize("{{a, {b}}, c}", &arena);
+        copy = set;
+        Set constructed(set);
+        EXPECT_EQ(constructed.resource(), std::pmr::get_default_resource());
+        for (const auto& element : constructed) {
+            if (element.type == Set::NESTED_SET) {
+                EXPECT_NE(element.subset.resource(), &arena);
+            }
+        }
+        Set moved(std::move(constructed));
+        EXPECT_EQ(moved, set);
+    }
+    // Арена уже освобождена целиком, копия от неё не зависит
+    EXPECT_EQ(copy.serialize(), "{{a, {b}}, c}");
+}
+
+TEST(SetArenaTest, InsertIntoArenaClonesForeignNodes) {
+    std::pmr::monotonic_buffer_resource arena;
+    Set set(&arena);
+    Set::Element nested(std::vector<Set::Element>{Set::Element("x"), Set::Element("y")});
+    set.insert(nested);
+    const Set::Element& stored = *set.begin();
+    EXPECT_EQ(stored.subset.resource(), &arena);
+    EXPECT_FALSE(stored.subset.sharesNodeWith(nested.subset));
+    EXPECT_EQ(stored, nested);
+}
+
+// --- Неизменяемые множества ---
+TEST(PersistentSetTest, InsertAndEraseReturnNewVersions) {
+    PersistentSet empty;
+    PersistentSet one = empty.insert(Set::Element("a"));
+    PersistentSet two = one.insert(Set::Element(std::vector<Set::Element>{Set::Element("x"), Set::Element("y")}));
+    EXPECT_TRUE(empty.isEmpty());
+    EXPECT_EQ(one.size(), 1u);
+    EXPECT_EQ(two.size(), 2u);
+    EXPECT_TRUE(two.contains(Set::Element(std::vector<Set::Element>{Set::Element("y"), Set::Element("x")})));
+    EXPECT_FALSE(one.contains(Set::Element(std::vector<Set::Element>{Set::Element("x"), Set::Element("y")})));
+
+    PersistentSet back = two.erase(Set::Element("a"));
+    EXPECT_EQ(back.size(), 1u);
+    EXPECT_FALSE(back.contains(Set::Element("a")));
+    EXPECT_TRUE(two.contains(Set::Element("a")));
+    EXPECT_TRUE(back.erase(Set::Element("missing")).sharesRootWith(back));
+    EXPECT_TRUE(two.insert(Set::Element("a")).sharesRootWith(two));
+}
+
+TEST(PersistentSetTest, MatchesSetOnLargeInput) {
+    Set reference;
+    PersistentSet persistent;
+    for (int i = 0; i < 5000; ++i) {
+        Set::Element element("p" + std::to_string(i));
+        reference.insert(element);
+        persistent = persistent.insert(element);
+    }
+    EXPECT_EQ(persistent.size(), reference.size());
+    for (int i = 0; i < 5000; i += 2) {
+        persistent = persistent.erase(Set::Element("p" + std::to_string(i)));
+    }
+    EXPECT_EQ(persistent.size(), 2500u);
+    for (int i = 0; i < 5000; ++i) {
+        EXPECT_EQ(persistent.contains(Set::Element("p" + std::to_string(i))), i % 2 == 1);
+    }
+    Set odd = persistent.toSet();
+    EXPECT_EQ(odd.size(), 2500u);
+    EXPECT_EQ(PersistentSet(odd), persistent);
+    for (int i = 1; i < 5000; i += 2) {
+        persistent = persistent.erase(Set::Element("p" + std::to_string(i)));
+    }
+    EXPECT_TRUE(persistent.isEmpty());
+}
+
+TEST(PersistentSetTest, ConvertsFromSet) {
+    Set set("{a, {b, c}, {}, d}");
+    PersistentSet persistent(set);
+    EXPECT_EQ(persistent.size(), 4u);
+    EXPECT_EQ(persistent.toSet(), set);
+    EXPECT_NE(persistent, persistent.erase(Set::Element("d")));
+}
+
+TEST(PersistentSetTest, ReadersSeePublishedSnapshots) {
+    VersionedSet shared;
+    const int total = 2000;
+    std::atomic<bool> done{false};
+    std::atomic<int> failures{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&]() {
+            std::size_t last = 0;
+            while (!done.load()) {
+                PersistentSet snapshot = shared.snapshot();
+                // Писатель добавляет элементы по порядку, поэтому версия
+                // размера k содержит ровно первые k элементов
+                if (snapshot.size() < last) ++failures;
+                last = snapshot.size();
+                if (last > 0 && !snapshot.contains(Set::Element("v" + std::to_string(last - 1)))) ++failures;
+                if (snapshot.contains(Set::Element("v" + std::to_string(last)))) ++failures;
+            }
+        });
+    }
+    for (int i = 0; i < total; ++i) {
+        shared.update([i](const PersistentSet& current) {
+            return current.insert(Set::Element("v" + std::to_string(i)));
+        });
+    }
+    done = true;
+    for (auto& reader : readers) reader.join();
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(shared.snapshot().size(), static_cast<std::size_t>(total));
+    EXPECT_EQ(shared.version(), static_cast<std::uint64_t>(total));
+}
+
+// --- Инвертированный индекс по набору множеств ---
+class SetCollectionTest : public ::testing::Test {
+protected:
+    SetCollection collection;
+    std::vector<Set> sets{
+        Set("{a, b, c}"), Set("{a, b}"), Set("{}"), Set("{b, {x, y}}"),
+        Set("{a, b, c, d, {y, x}}"), Set("{d}"), Set("{c, a}")
+    };
+
+    void SetUp() override {
+        for (const auto& set : sets) collection.add(set);
+    }
+
+    bool isSubset(const Set& inner, const Set& outer) {
+        return inner.difference(outer).isEmpty();
+    }
+
+    std::vector<SetCollection::SetId> bruteForce(const std::function<bool(const Set&)>& predicate) {
+        std::vector<SetCollection::SetId> ids;
+        for (SetCollection::SetId id = 0; id < sets.size(); ++id) {
+            if (collection.has(id) && predicate(collection.get(id))) ids.push_back(id);
+        }
+        return ids;
+    }
+};
+
+TEST_F(SetCollectionTest, MembershipQueries) {
+    Set::Element xy(std::vector<Set::Element>{Set::Element("x"), Set::Element("y")});
+    EXPECT_EQ(collection.containing(Set::Element("a")), (std::vector<SetCollection::SetId>{0, 1, 4, 6}));
+    EXPECT_EQ(collection.containing(xy), (std::vector<SetCollection::SetId>{3, 4}));
+    EXPECT_TRUE(collection.containing(Set::Element("zzz")).empty());
+}
+
+TEST_F(SetCollectionTest, SubsetAndSupersetQueriesMatchScan) {
+    for (const auto& query : {Set("{a, b}"), Set("{}"), Set("{a, b, c, d, {x, y}}"), Set("{b, {y, x}}"), Set("{q}")}) {
+        EXPECT_EQ(collection.supersetsOf(query),
+                  bruteForce([&](const Set& set) { return isSubset(query, set); })) << query;
+        EXPECT_EQ(collection.subsetsOf(query),
+                  bruteForce([&](const Set& set) { return isSubset(set, query); })) << query;
+    }
+}
+
+TEST_F(SetCollectionTest, JaccardSimilarity) {
+    auto matches = collection.similarTo(Set("{a, b, c}"), 0.5);
+    std::vector<SetCollection::SetId> ids;
+    for (const auto& match : matches) ids.push_back(match.id);
+    EXPECT_EQ(ids, (std::vector<SetCollection::SetId>{0, 1, 4, 6}));
+    EXPECT_DOUBLE_EQ(matches[0].similarity, 1.0);
+    EXPECT_DOUBLE_EQ(matches[1].similarity, 2.0 / 3.0);
+    EXPECT_EQ(collection.similarTo(Set("{zzz}"), 0.0).size(), sets.size());
+    auto empty = collection.similarTo(Set("{}"), 1.0);
+    ASSERT_EQ(empty.size(), 1u);
+    EXPECT_EQ(empty[0].id, 2u);
+}
+
+TEST_F(SetCollectionTest, IncrementalUpdates) {
+    collection.remove(0);
+    collection.update(5, Set("{a, e}"));
+    SetCollection::SetId added = collection.add(Set("{a}"));
+    EXPECT_EQ(collection.size(), sets.size());
+    EXPECT_FALSE(collection.has(0));
+    EXPECT_THROW(collection.get(0), std::out_of_range);
+    EXPECT_EQ(collection.containing(Set::Element("a")), (std::vector<SetCollection::SetId>{1, 4, 5, 6, added}));
+    EXPECT_TRUE(collection.containing(Set::Element("d")) == (std::vector<SetCollection::SetId>{4}));
+    EXPECT_EQ(collection.subsetsOf(Set("{a, e}")), (std::vector<SetCollection::SetId>{2, 5, added}));
+}
+
+// --- Массовое построение ---
+TEST(SetBulkConstructionTest, DeduplicatesPreservingFirstOccurrence) {
+    std::vector<Set::Element> items;
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 100; ++i) {
+            items.push_back(Set::Element("b" + std::to_string(i)));
+        }
+        items.push_back(Set::Element(std::vector<Set::Element>{Set::Element("x"), Set::Element("y")}));
+        items.push_back(Set::Element(std::vector<Set::Element>{Set::Element("y"), Set::Element("x")}));
+    }
+    Set fromRange(items.begin(), items.end());
+    Set fromVector(std::move(items));
+    EXPECT_EQ(fromRange.size(), 101u);
+    EXPECT_EQ(fromVector, fromRange);
+    EXPECT_EQ(*fromRange.begin(), Set::Element("b0"));
+}
+
+TEST(SetBulkConstructionTest, LargeInputUsesPartitions) {
+    const int count = static_cast<int>(Set::PARALLEL_THRESHOLD) * 2;
+    std::vector<Set::Element> items;
+    items.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        items.push_back(Set::Element("L" + std::to_string(i % (count / 4))));
+    }
+    Set set(std::move(items));
+    ASSERT_EQ(set.size(), static_cast<std::size_t>(count / 4));
+    int expected = 0;
+    for (const auto& element : set) {
+        EXPECT_EQ(element, Set::Element("L" + std::to_string(expected++)));
+    }
+}
+
+// --- Глубокая вложенность ---
+TEST(SetDeepNestingTest, ParseSerializeAndDestroyWithoutRecursion) {
+    const std::size_t depth = 100000;
+    std::string input(depth, '{');
+    input += "a";
+    input += std::string(depth, '}');
+    {
+        Set set(input);
+        EXPECT_EQ(set.size(), 1u);
+        EXPECT_EQ(set.serialize(), input);
+        std::size_t levels = 1;
+        const Set::Element* current = &*set.begin();
+        while (current->type == Set::NESTED_SET) {
+            current = &current->subset[0];
+            ++levels;
+        }
+        EXPECT_EQ(levels, depth);
+        EXPECT_EQ(current->atom, "a");
+    }
+    EXPECT_THROW(Set(std::string(depth, '{') + std::string(depth - 1, '}')), std::invalid_argument);
+}
+
+TEST(SetDeepNestingTest, SerializeMatchesLegacyLayout) {
+    EXPECT_EQ(Set("{ {a ,{ }}, b,{{c},d} }").serialize(), "{{a, {}}, b, {{c}, d}}");
+    EXPECT_THROW(Set("{{a} {b}}"), std::invalid_argument);
+    EXPECT_THROW(Set("{a{b}}"), std::invalid_argument);
+}
+
+TEST(SetDeepNestingTest, CompareWithoutRecursion) {
+    const std::size_t depth = 100000;
+    auto nested = [depth](const std::string& leaf, bool reversed) {
+        std::string input;
+        for (std::size_t i = 0; i < depth; ++i) input += reversed ? "{" : "{x, ";
+        input += leaf;
+        for (std::size_t i = 0; i < depth; ++i) input += reversed ? ", x}" : "}";
+        return "{" + input + "}";
+    };
+    const Set left(nested("a", false));
+    const Set same(nested("a", false));
+    const Set reordered(nested("a", true));
+    const Set other(nested("b", true));
+    EXPECT_EQ(left, same);
+    EXPECT_EQ(left, reordered);
+    EXPECT_NE(left, other);
+    EXPECT_TRUE(left.contains(*reordered.begin()));
+    EXPECT_FALSE(left.contains(*other.begin()));
+    Set united(left);
+    united.insert(*reordered.begin());
+    united.insert(*other.begin());
+    EXPECT_EQ(united.size(), 2u);
+}
+
+TEST(SetDeepNestingTest, BinaryRoundTripWithoutRecursion) {
+    const std::size_t depth = 100000;
+    const Set set(std::string(depth, '{') + "a, {}" + std::string(depth, '}'));
+    const Set restored = Set::deserializeBinary(set.serializeBinary());
+    EXPECT_EQ(restored, set);
+    EXPECT_EQ(restored.serialize(), set.serialize());
+}
+
+TEST(SetDeepNestingTest, CopyAcrossResourcesWithoutRecursion) {
+    const std::size_t depth = 100000;
+    const Set set(std::string(depth, '{') + "a, {b}" + std::string(depth, '}'));
+    std::pmr::monotonic_buffer_resource arena;
+    const Set copy(set, &arena);
+    EXPECT_EQ(copy.begin()->subset.resource(), &arena);
+    EXPECT_FALSE(copy.begin()->subset.sharesNodeWith(set.begin()->subset));
+    EXPECT_EQ(copy, set);
+    Set moved(&arena);
+    moved = Set(set);
+    EXPECT_EQ(moved.begin()->subset.resource(), &arena);
+    EXPECT_EQ(moved.serialize(), set.serialize());
+}
+
+// --- Векторный сканер структуры ---
+TEST(StructuralScannerTest, KernelsAgree) {
+    std::string input;
+    const std::string alphabet = "{},ab_9 \t\r\nZ";
+    std::uint32_t state = 12345;
+    for (int i = 0; i < 1000; ++i) {
+        state = state * 1103515245u + 12345u;
+        input += alphabet[(state >> 16) % alphabet.size()];
+    }
+    for (std::size_t length : {0u, 7u, 16u, 31u, 33u, 64u, 1000u}) {
+        std::string_view view(input.data(), length);
+        StructuralIndex scalar = StructuralScanner::scan(view, StructuralScanner::Kernel::SCALAR);
+        for (auto kernel : {StructuralScanner::Kernel::SSE2, StructuralScanner::Kernel::AVX2}) {
+            StructuralIndex vector = StructuralScanner::scan(view, kernel);
+            EXPECT_EQ(vector.positions, scalar.positions) << length;
+            EXPECT_TRUE(vector.valid);
+        }
+    }
+}
+
+TEST(StructuralScannerTest, DetectsForeignBytes) {
+    for (std::size_t at : {0u, 15u, 16u, 40u, 70u}) {
+        for (char bad : {'#', '\x80', '\xff', '[', '`', '@'}) {
+            std::string input(72, 'a');
+            input[at] = bad;
+            for (auto kernel : {StructuralScanner::Kernel::SCALAR, StructuralScanner::Kernel::SSE2,
+                                StructuralScanner::Kernel::AVX2}) {
+                EXPECT_FALSE(StructuralScanner::scan(input, kernel).valid) << at << ' ' << int(bad);
+            }
+        }
+    }
+}
+
+TEST(StructuralScannerTest, IndexedParsingKeepsLegacyRules) {
+    EXPECT_EQ(Set("{a,,b}").size(), 3u);
+    EXPECT_EQ(Set("{a, b,}").size(), 2u);
+    EXPECT_TRUE(Set("{ a b , c}").has(Set::Element("ab")));
+    EXPECT_EQ(Set("{{}, {{}}, { a , {b} } }").serialize(), "{{}, {{}}, {a, {b}}}");
+    EXPECT_THROW(Set("{a}}"), std::invalid_argument);
+    EXPECT_THROW(Set("{a} {b}"), std::invalid_argument);
+    EXPECT_THROW(Set("{{a}, b"), std::invalid_argument);
+    EXPECT_THROW(Set("{a, b#}"), std::invalid_argument);
+}
+
+// --- Вычисление выражений ---
+TEST(SetEvaluatorTest, LiteralsAndOperators) {
+    EXPECT_EQ(SetEvaluator::evaluate("{a, {b}}"), Set("{a, {b}}"));
+    EXPECT_EQ(SetEvaluator::evaluate("{a, b} | {c}"), Set("{a, b, c}"));
+    EXPECT_EQ(SetEvaluator::evaluate("{a, b, c} - {b} - {c}"), Set("{a}"));
+    EXPECT_EQ(SetEvaluator::evaluate("{a, b} ^ {b, c}"), Set("{a, c}"));
+    EXPECT_EQ(SetEvaluator::evaluate("{x} | {a, b} & {b, c}"), Set("{x, b}"));
+    EXPECT_EQ(SetEvaluator::evaluate("({x} | {a, b}) & {b, x}"), Set("{x, b}"));
+    EXPECT_EQ(SetEvaluator::evaluate(" {{a, b}} & {{b, a}} "), Set("{{a, b}}"));
+}
+
+TEST(SetEvaluatorTest, DeepParenthesesWithoutRecursion) {
+    const std::size_t depth = 200000;
+    const std::string nested = std::string(depth, '(') + "{a} | {b}" + std::string(depth, ')');
+    EXPECT_EQ(SetEvaluator::evaluate(nested + " & {a}"), Set("{a}"));
+    EXPECT_EQ(SetEvaluator::evaluate("{c} - " + nested), Set("{c}"));
+    EXPECT_THROW(SetEvaluator::evaluate(std::string(depth, '(') + "{a}"), std::invalid_argument);
+    EXPECT_THROW(SetEvaluator::evaluate("{a})"), std::invalid_argument);
+}
+
+TEST(SetEvaluatorTest, InvalidExpressions) {
+    EXPECT_THROW(SetEvaluator::evaluate(""), std::invalid_argument);
+    EXPECT_THROW(SetEvaluator::evaluate("{a} |"), std::invalid_argument);
+    EXPECT_THROW(SetEvaluator::evaluate("({a}"), std::invalid_argument);
+    EXPECT_THROW(SetEvaluator::evaluate("{a, {b}"), std::invalid_argument);
+    EXPECT_THROW(SetEvaluator::evaluate("{a} {b}"), std::invalid_argument);
+    EXPECT_THROW(SetEvaluator::evaluate("{a, #}"), std::invalid_argument);
+}
+
+// --- Счётчики операций ---
+#ifdef SET_ENABLE_STATS
+TEST(SetStatsTest, CountsPerOperation) {
+    Set left("{a, {b, c}, d}");
+    Set right("{{c, b}, e}");
+    SetStats::reset();
+    Set united = left.unite(right);
+    EXPECT_TRUE(united.has(Set::Element("e")));
+    auto stats = SetStats::snapshot();
+    ASSERT_EQ(stats.count("unite"), 1u);
+    const OperationStats& unite = stats["unite"];
+    EXPECT_EQ(unite.calls, 1u);
+    EXPECT_GT(unite.comparisons, 0u);
+    EXPECT_GT(unite.allocations, 0u);
+    EXPECT_GE(unite.bytesCopied, 3 * sizeof(Set::Element));
+    // Вложенные вызовы insert и contains учтены внутри unite
+    EXPECT_EQ(stats.count("insert"), 0u);
+    EXPECT_EQ(stats.count("contains"), 1u);
+    EXPECT_EQ(stats["contains"].calls, 1u);
+}
+
+TEST(SetStatsTest, CountsIndexAllocations) {
+    std::vector<Set::Element> items;
+    for (int i = 0; i < 100; ++i) {
+        items.emplace_back("s" + std::to_string(i));
+    }
+    const Set small(std::vector<Set::Element>(items.begin(), items.begin() + 50));
+    const Set large(std::move(items));
+    SetStats::reset();
+    // Первая проверка строит индекс отпечатков большего множества
+    EXPECT_TRUE(small.isSubsetOf(large));
+    auto stats = SetStats::snapshot();
+    ASSERT_EQ(stats.count("isSubsetOf"), 1u);
+    EXPECT_GT(stats["isSubsetOf"].allocations, 0u);
+}
+
+TEST(SetStatsTest, PoolTasksCountTowardsCaller) {
+    std::vector<Set::Element> left;
+    std::vector<Set::Element> right;
+    for (std::size_t i = 0; i < Set::PARALLEL_THRESHOLD; ++i) {
+        left.emplace_back("l" + std::to_string(i));
+        right.emplace_back("l" + std::to_string(i + Set::PARALLEL_THRESHOLD / 2));
+    }
+    const Set a(std::move(left));
+    const Set b(std::move(right));
+    ThreadPool pool(3);
+    SetStats::reset();
+    const Set united = a.parallelUnite(b, pool);
+    EXPECT_EQ(united.size(), Set::PARALLEL_THRESHOLD * 3 / 2);
+    auto stats = SetStats::snapshot();
+    // Сравнения в потоках пула не открывают собственных операций
+    EXPECT_EQ(stats.size(), 1u);
+    ASSERT_EQ(stats.count("parallelUnite"), 1u);
+    EXPECT_GE(stats["parallelUnite"].comparisons, Set::PARALLEL_THRESHOLD / 2);
+    EXPECT_GT(stats["parallelUnite"].allocations, 0u);
+}
+
+TEST(SetStatsTest, ResetClearsTable) {
+    Set set("{a}");
+    EXPECT_TRUE(set.contains(Set::Element("a")));
+    SetStats::reset();
+    EXPECT_TRUE(SetStats::snapshot().empty());
+}
+#else
+TEST(SetStatsTest, DisabledByDefault) {
+    Set set("{a, {b}}");
+    EXPECT_TRUE(set.unite(Set("{{b}, c}")).has(Set::Element("c")));
+    EXPECT_FALSE(SetStats::enabled);
+    EXPECT_TRUE(SetStats::snapshot().empty());
+}
+#endif
+
+// --- Занимаемая память и уплотнение ---
+TEST(SetCompactTest, MemoryUsageCountsNodesOnce) {
+    Set flat("{a, b, c}");
+    EXPECT_GE(flat.memoryUsage(), sizeof(Set) + 3 * sizeof(Set::Element));
+
+    Set nested("{{a, b}, x}");
+    const std::size_t single = nested.memoryUsage();
+    // Копия разделяет узел, поэтому второе вхождение ничего не добавляет
+    Set::Element shared = *nested.begin();
+    Set twice;
+    twice.insert(shared);
+    twice.insert(Set::Element(std::vector<Set::Element>{shared}));
+    Set fresh;
+    fresh.insert(Set::Element(std::vector<Set::Element>{Set::Element("a"), Set::Element("b")}));
+    fresh.insert(Set::Element(std::vector<Set::Element>{
+        Set::Element(std::vector<Set::Element>{Set::Element("a"), Set::Element("b")})}));
+    EXPECT_LT(twice.memoryUsage(), fresh.memoryUsage());
+    EXPECT_GT(single, sizeof(Set));
+}
+
+TEST(SetCompactTest, LongAtomsAreCounted) {
+    Set shortAtom("{a}");
+    Set longAtom("{an_atom_that_does_not_fit_into_small_string_buffer}");
+    EXPECT_GT(longAtom.memoryUsage(), shortAtom.memoryUsage());
+}
+
+TEST(SetCompactTest, CompactSharesIdenticalSubsets) {
+    std::string text = "{";
+    for (int i = 0; i < 50; ++i) {
+        if (i > 0) text += ", ";
+        text += "{u" + std::to_string(i) + ", {read, write}, {{admin}, {read, write}}}";
+    }
+    text += "}";
+    Set set(text);
+    Set original(text);
+    const std::size_t before = set.memoryUsage();
+    set.compact();
+    const std::size_t after = set.memoryUsage();
+    EXPECT_LT(after, before);
+    EXPECT_EQ(set, original);
+    EXPECT_EQ(set.serialize(), original.serialize());
+
+    // Одинаковые подмножества разных элементов теперь один узел
+    const Set::Element& first = *set.begin();
+    const Set::Element& second = *(set.begin() + 1);
+    EXPECT_TRUE(first.subset[1].subset.sharesNodeWith(second.subset[1].subset));
+    EXPECT_TRUE(first.subset[1].subset.sharesNodeWith(first.subset[2].subset[1].subset));
+}
+
+TEST(SetCompactTest, CompactLeavesSharedNodesIntact) {
+    Set source("{{a, {b}}, {x, {b}}, {c}}");
+    Set copy(source);
+    copy.compact();
+    EXPECT_EQ(copy, source);
+    EXPECT_EQ(copy.serialize(), "{{a, {b}}, {x, {b}}, {c}}");
+    // Узлы копии разделены с исходным множеством и не переписываются
+    const Set::Element& first = *source.begin();
+    const Set::Element& second = *(source.begin() + 1);
+    EXPECT_FALSE(first.subset[1].subset.sharesNodeWith(second.subset[1].subset));
+}
+
+TEST(SetCompactTest, CompactReleasesSpareCapacity) {
+    Set set;
+    for (int i = 0; i < 100; ++i) {
+        set.insert(Set::Element("e" + std::to_string(i)));
+    }
+    for (int i = 0; i < 90; ++i) {
+        set.erase(Set::Element("e" + std::to_string(i)));
+    }
+    const std::size_t before = set.memoryUsage();
+    set.compact();
+    EXPECT_LT(set.memoryUsage(), before);
+    EXPECT_EQ(set.size(), 10u);
+}
+
+// --- Кеш сериализации и хеш содержимого ---
+TEST(SetCacheTest, SerializeIsInvalidatedByMutations) {
+    Set set("{a, {b, c}}");
+    EXPECT_EQ(set.serialize(), "{a, {b, c}}");
+    EXPECT_EQ(set.serialize(), "{a, {b, c}}");
+    set.insert(Set::Element("d"));
+    EXPECT_EQ(set.serialize(), "{a, {b, c}, d}");
+    set.erase(Set::Element("a"));
+    EXPECT_EQ(set.serialize(), "{{b, c}, d}");
+    set.selfUnite(Set("{e}"));
+    EXPECT_EQ(set.serialize(), "{{b, c}, d, e}");
+    set.selfIntersect(Set("{d, e}"));
+    EXPECT_EQ(set.serialize(), "{d, e}");
+    set.selfDifference(Set("{d}"));
+    EXPECT_EQ(set.serialize(), "{e}");
+    set = Set("{x}");
+    std::ostringstream out;
+    out << set;
+    EXPECT_EQ(out.str(), "{x}");
+}
+
+TEST(SetCacheTest, CopiesKeepCacheAndStayIndependent) {
+    Set original("{a, b}");
+    EXPECT_EQ(original.serialize(), "{a, b}");
+    Set copy(original);
+    copy.insert(Set::Element("c"));
+    EXPECT_EQ(copy.serialize(), "{a, b, c}");
+    EXPECT_EQ(original.serialize(), "{a, b}");
+    Set moved(std::move(copy));
+    EXPECT_EQ(moved.serialize(), "{a, b, c}");
+    Set rvalue = Set("{a}").unite(Set("{b}"));
+    EXPECT_EQ(rvalue.serialize(), "{a, b}");
+}
+
+TEST(SetCacheTest, ContentHashIgnoresOrder) {
+    Set first("{a, {b, c}, d}");
+    Set second("{d, {c, b}, a}");
+    EXPECT_EQ(first.contentHash(), second.contentHash());
+    EXPECT_NE(first.contentHash(), Set("{a, {b}, d}").contentHash());
+    // Хеш множества совпадает с хешем такого же вложенного элемента
+    Set::Element nested(std::vector<Set::Element>(first.begin(), first.end()));
+    EXPECT_EQ(first.contentHash(), Set::ElementHash()(nested));
+
+    const std::uint64_t before = first.contentHash();
+    first.insert(Set::Element("e"));
+    EXPECT_NE(first.contentHash(), before);
+    first.erase(Set::Element("e"));
+    EXPECT_EQ(first.contentHash(), before);
+}
+
+TEST(SetCacheTest, SetsAsUnorderedKeys) {
+    std::unordered_set<Set> sets;
+    sets.insert(Set("{a, b}"));
+    sets.insert(Set("{b, a}"));
+    sets.insert(Set("{{a}, b}"));
+    EXPECT_EQ(sets.size(), 2u);
+    EXPECT_EQ(sets.count(Set("{b, {a}}")), 1u);
+    EXPECT_EQ(std::hash<Set>()(Set("{}")), std::hash<Set>()(Set()));
+}
+
+// --- Фильтр Блума для промахов ---
+TEST(BloomFilterTest, NoFalseNegatives) {
+    BloomFilter filter(1000);
+    for (std::uint64_t i = 0; i < 1000; ++i) {
+        filter.add(Set::ElementHash()(Set::Element("k" + std::to_string(i))));
+    }
+    for (std::uint64_t i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(filter.mayContain(Set::ElementHash()(Set::Element("k" + std::to_string(i)))));
+    }
+    std::size_t falsePositives = 0;
+    for (std::uint64_t i = 0; i < 10000; ++i) {
+        if (filter.mayContain(Set::ElementHash()(Set::Element("miss" + std::to_string(i))))) ++falsePositives;
+    }
+    EXPECT_LT(falsePositives, 300u);
+    EXPECT_LT(filter.falsePositiveRate(), 0.02);
+    EXPECT_GE(filter.bits(), 1000 * BloomFilter::BITS_PER_ENTRY);
+}
+
+TEST(SetFilterTest, BuiltForLargeSetsOnly) {
+    Set small("{a, b, c}");
+    EXPECT_FALSE(small.contains(Set::Element("z")));
+    EXPECT_FALSE(small.filterStats().active);
+
+    Set large;
+    for (std::size_t i = 0; i < 200; ++i) {
+        large.insert(Set::Element("k" + std::to_string(i)));
+    }
+    EXPECT_FALSE(large.contains(Set::Element("missing")));
+    const Set::FilterStats stats = large.filterStats();
+    EXPECT_TRUE(stats.active);
+    EXPECT_EQ(stats.entries, 200u);
+    EXPECT_GT(stats.bytes, 0u);
+    EXPECT_LT(stats.falsePositiveRate, 0.05);
+}
+
+TEST(SetFilterTest, MaintainedOnInsertAndErase) {
+    Set set;
+    for (std::size_t i = 0; i < 100; ++i) {
+        set.insert(Set::Element(std::vector<Set::Element>{Set::Element("n" + std::to_string(i))}));
+    }
+    for (std::size_t i = 0; i < 100; ++i) {
+        EXPECT_TRUE(set.has(Set::Element(std::vector<Set::Element>{Set::Element("n" + std::to_string(i))})));
+    }
+    // Вставки после построения фильтра попадают в него
+    for (std::size_t i = 100; i < 1000; ++i) {
+        set.insert(Set::Element("v" + std::to_string(i)));
+        EXPECT_TRUE(set.has(Set::Element("v" + std::to_string(i))));
+    }
+    // Удаление большей части записей перестраивает фильтр
+    for (std::size_t i = 100; i < 1000; ++i) {
+        set.erase(Set::Element("v" + std::to_string(i)));
+    }
+    EXPECT_FALSE(set.has(Set::Element("v500")));
+    EXPECT_EQ(set.filterStats().entries, 100u);
+    set.selfDifference(Set("{{n1}, {n2}}"));
+    EXPECT_FALSE(set.has(Set::Element(std::vector<Set::Element>{Set::Element("n1")})));
+    EXPECT_TRUE(set.has(Set::Element(std::vector<Set::Element>{Set::Element("n3")})));
+    EXPECT_EQ(set.size(), 98u);
+}
+
+TEST(SetFilterTest, InsertsBelowThresholdKeepFilterExact) {
+    Set set;
+    for (std::size_t i = 0; i < Set::FILTER_THRESHOLD; ++i) {
+        set.insert(Set::Element("k" + std::to_string(i)));
+    }
+    EXPECT_FALSE(set.has(Set::Element("none")));
+    set.erase(Set::Element("k0"));
+    set.insert(Set::Element("fresh"));
+    EXPECT_TRUE(set.has(Set::Element("fresh")));
+}
+
+TEST(SetFilterTest, CanBeDisabled) {
+    Set set;
+    for (std::size_t i = 0; i < 100; ++i) {
+        set.insert(Set::Element("k" + std::to_string(i)));
+    }
+    set.setFilterEnabled(false);
+    EXPECT_FALSE(set.has(Set::Element("none")));
+    EXPECT_TRUE(set.has(Set::Element("k5")));
+    EXPECT_FALSE(set.filterStats().active);
+    Set copy(set);
+    EXPECT_FALSE(copy.has(Set::Element("none")));
+    EXPECT_FALSE(copy.filterStats().active);
+}
+
+// --- Декартово произведение и симметрическая разность ---
+TEST(SetProductTest, PairsAreKuratowskiEncoded) {
+    EXPECT_EQ(SetProduct::pair(Set::Element("a"), Set::Element("b")),
+              Set("{{{a}, {a, b}}}").begin()[0]);
+    EXPECT_EQ(SetProduct::pair(Set::Element("a"), Set::Element("a")), Set("{{{a}}}").begin()[0]);
+    EXPECT_NE(SetProduct::pair(Set::Element("a"), Set::Element("b")),
+              SetProduct::pair(Set::Element("b"), Set::Element("a")));
+
+    Set::Element first;
+    Set::Element second;
+    ASSERT_TRUE(SetProduct::unpair(Set("{{{b, a}, {a}}}").begin()[0], first, second));
+    EXPECT_EQ(first, Set::Element("a"));
+    EXPECT_EQ(second, Set::Element("b"));
+    ASSERT_TRUE(SetProduct::unpair(Set("{{{x}, {x}}}").begin()[0], first, second));
+    EXPECT_EQ(first, Set::Element("x"));
+    EXPECT_EQ(second, Set::Element("x"));
+    EXPECT_FALSE(SetProduct::unpair(Set::Element("a"), first, second));
+    EXPECT_FALSE(SetProduct::unpair(Set("{{{a}, {b, c}}}").begin()[0], first, second));
+}
+
+TEST(SetProductTest, CountRandomAccessAndIteration) {
+    Set left("{1, 2, 3}");
+    Set right("{x, {y}}");
+    SetProduct product = left.product(right);
+    EXPECT_EQ(product.size(), 6u);
+    EXPECT_FALSE(product.empty());
+    EXPECT_EQ(product[0], SetProduct::pair(Set::Element("1"), Set::Element("x")));
+    EXPECT_EQ(product[5], SetProduct::pair(Set::Element("3"), Set("{{y}}").begin()[0]));
+    EXPECT_THROW(product.at(6), std::out_of_range);
+
+    std::size_t visited = 0;
+    for (const Set::Element& pair : product) {
+        EXPECT_TRUE(product.contains(pair));
+        ++visited;
+    }
+    EXPECT_EQ(visited, 6u);
+    EXPECT_FALSE(product.contains(SetProduct::pair(Set::Element("x"), Set::Element("1"))));
+
+    Set evaluated = product.evaluate();
+    EXPECT_EQ(evaluated.size(), 6u);
+    EXPECT_TRUE(evaluated.has(SetProduct::pair(Set::Element("2"), Set::Element("x"))));
+    const Set none;
+    EXPECT_TRUE(none.product(left).empty());
+    EXPECT_EQ(left.product(none).size(), 0u);
+}
+
+template <class Left, class Right, class = void>
+struct HasProduct : std::false_type {};
+template <class Left, class Right>
+struct HasProduct<Left, Right, std::void_t<decltype(std::declval<Left>().product(std::declval<Right>()))>>
+    : std::true_type {};
+
+TEST(SetProductTest, TemporaryOperandsRejected) {
+    static_assert(HasProduct<const Set&, const Set&>::value, "lvalue operands");
+    static_assert(HasProduct<Set&, Set&>::value, "lvalue operands");
+    static_assert(!HasProduct<const Set&, Set>::value, "temporary right operand");
+    static_assert(!HasProduct<Set, const Set&>::value, "temporary left operand");
+    static_assert(!HasProduct<Set, Set>::value, "temporary operands");
+    static_assert(!std::is_constructible<SetProduct, Set, const Set&>::value, "temporary left operand");
+    static_assert(!std::is_constructible<SetProduct, const Set&, Set>::value, "temporary right operand");
+    static_assert(std::is_constructible<SetProduct, const Set&, const Set&>::value, "lvalue operands");
+    SUCCEED();
+}
+
+TEST(SetProductTest, EmptyRightOperand) {
+    Set left("{1, 2}");
+    Set empty;
+    SetProduct product = left.product(empty);
+    EXPECT_TRUE(product.empty());
+    EXPECT_EQ(product.begin(), product.end());
+    EXPECT_THROW(product[0], std::out_of_range);
+    EXPECT_THROW(product.at(0), std::out_of_range);
+}
+
+TEST(SetProductTest, LargeProductIsNotMaterialized) {
+    std::vector<Set::Element> items;
+    for (int i = 0; i < 100000; ++i) {
+        items.emplace_back("e" + std::to_string(i));
+    }
+    Set big(std::move(items));
+    SetProduct product = big.product(big);
+    EXPECT_EQ(product.size(), 10000000000u);
+    EXPECT_EQ(product[99999 * 100000ULL + 7],
+              SetProduct::pair(Set::Element("e99999"), Set::Element("e7")));
+}
+
+TEST(SetSymmetricDifferenceTest, SinglePass) {
+    EXPECT_EQ(Set("{a, b, c}").symmetricDifference(Set("{b, c, d}")), Set("{a, d}"));
+    EXPECT_EQ(Set("{a, {b}}").symmetricDifference(Set("{{b}, c}")).serialize(), "{a, c}");
+    EXPECT_EQ(Set("{a}").symmetricDifference(Set("{a}")), Set());
+    EXPECT_EQ(Set().symmetricDifference(Set("{a}")), Set("{a}"));
+
+    std::vector<Set::Element> left;
+    std::vector<Set::Element> right;
+    for (int i = 0; i < 200; ++i) {
+        left.emplace_back("k" + std::to_string(i));
+        right.emplace_back("k" + std::to_string(i + 100));
+    }
+    Set result = Set(left).symmetricDifference(Set(right));
+    EXPECT_EQ(result.size(), 200u);
+    EXPECT_TRUE(result.has(Set::Element("k0")));
+    EXPECT_TRUE(result.has(Set::Element("k299")));
+    EXPECT_FALSE(result.has(Set::Element("k150")));
+    EXPECT_EQ(result, Set(left).difference(Set(right)).unite(Set(right).difference(Set(left))));
+}
+
+// --- Параллельные операции над большими множествами ---
+namespace {
+
+std::vector<Set::Element> rangeElements(std::size_t from, std::size_t to) {
+    std::vector<Set::Element> items;
+    for (std::size_t i = from; i < to; ++i) {
+        if (i % 5 == 0) {
+            items.emplace_back(std::vector<Set::Element>{Set::Element("n" + std::to_string(i)), Set::Element("x")});
+        } else {
+            items.emplace_back("a" + std::to_string(i));
+        }
+    }
+    return items;
+}
+
+}
+
+TEST(SetParallelAlgebraTest, MatchesSequentialResults) {
+    const Set left(rangeElements(0, 40000));
+    const Set right(rangeElements(20000, 60000));
+    const Set united = left.unite(right);
+    const Set common = left.intersect(right);
+    const Set onlyLeft = left.difference(right);
+    EXPECT_EQ(united.size(), 60000u);
+    EXPECT_EQ(common.size(), 20000u);
+    EXPECT_EQ(onlyLeft.size(), 20000u);
+
+    for (std::size_t workers : {0, 1, 3}) {
+        ThreadPool pool(workers);
+        EXPECT_EQ(left.parallelUnite(right, pool), united);
+        EXPECT_EQ(left.parallelIntersect(right, pool), common);
+        EXPECT_EQ(left.parallelDifference(right, pool), onlyLeft);
+    }
+    EXPECT_EQ(left.parallelUnite(right).size(), 60000u);
+}
+
+TEST(SetParallelAlgebraTest, SmallOperandsStaySequential) {
+    const Set left("{c, a, b}");
+    const Set right("{b, d}");
+    ThreadPool pool(3);
+    // Последовательный путь сохраняет порядок левого операнда
+    EXPECT_EQ(left.parallelUnite(right, pool).serialize(), "{c, a, b, d}");
+    EXPECT_EQ(left.parallelIntersect(right, pool).serialize(), "{b}");
+    EXPECT_EQ(left.parallelDifference(right, pool).serialize(), "{c, a}");
+}
+
+TEST(SetParallelAlgebraTest, ResultUsesLeftResource) {
+    std::pmr::monotonic_buffer_resource arena;
+    const Set left(Set(rangeElements(0, 30000)), &arena);
+    const Set right(rangeElements(10000, 40000));
+    ThreadPool pool(2);
+    const Set united = left.parallelUnite(right, pool);
+    EXPECT_EQ(united.resource(), &arena);
+    for (const auto& element : united) {
+        if (element.type == Set::NESTED_SET) {
+            EXPECT_EQ(element.subset.resource(), &arena);
+        }
+    }
+    EXPECT_EQ(united.size(), 40000u);
+}
+
+// Несинхронизированный ресурс, отмечающий обращения не из потока-владельца
+class OwnerThreadResource : public std::pmr::memory_resource {
+public:
+    std::atomic<bool> foreignThread{false};
+
+private:
+    std::thread::id owner_ = std::this_thread::get_id();
+    std::pmr::monotonic_buffer_resource arena_;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        if (std::this_thread::get_id() != owner_) foreignThread = true;
+        return arena_.allocate(bytes, alignment);
+    }
+    void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override {
+        if (std::this_thread::get_id() != owner_) foreignThread = true;
+        arena_.deallocate(pointer, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+TEST(SetParallelAlgebraTest, ForeignElementsClonedOnCallingThread) {
+    OwnerThreadResource resource;
+    const Set left(Set(rangeElements(0, 30000)), &resource);
+    const Set right(rangeElements(10000, 40000));
+    ThreadPool pool(3);
+    const Set united = left.parallelUnite(right, pool);
+    const Set common = left.parallelIntersect(right, pool);
+    const Set rest = left.parallelDifference(right, pool);
+    EXPECT_FALSE(resource.foreignThread);
+    EXPECT_EQ(united.size(), 40000u);
+    EXPECT_EQ(common.size(), 20000u);
+    EXPECT_EQ(rest.size(), 10000u);
+    for (const auto& element : united) {
+        if (element.type == Set::NESTED_SET) {
+            EXPECT_EQ(element.subset.resource(), &resource);
+        }
+    }
+
+    // Потокобезопасный ресурс можно заполнять из потоков пула
+    std::pmr::synchronized_pool_resource synchronized;
+    const Set shared(Set(rangeElements(0, 30000)), &synchronized);
+    EXPECT_EQ(shared.parallelUnite(right, pool), left.unite(right));
+}
+
+TEST(SetLinearAlgebraTest, IndexedSelfOperations) {
+    Set set(rangeElements(0, 100));
+    const Set other(rangeElements(50, 150));
+    Set united(set);
+    united.selfUnite(other);
+    EXPECT_EQ(united.size(), 150u);
+    EXPECT_TRUE(united.has(Set::Element("a149")));
+    Set common(set);
+    common.selfIntersect(other);
+    EXPECT_EQ(common.size(), 50u);
+    EXPECT_FALSE(common.has(Set::Element("a1")));
+    set.selfDifference(other);
+    EXPECT_EQ(set.size(), 50u);
+    EXPECT_TRUE(set.has(Set::Element("a1")));
+    EXPECT_FALSE(set.has(Set::Element("a51")));
+    set.selfUnite(set);
+    EXPECT_EQ(set.size(), 50u);
+    set.selfIntersect(set);
+    EXPECT_EQ(set.size(), 50u);
+    set.selfDifference(set);
+    EXPECT_TRUE(set.isEmpty());
+}
+
+// --- Отношения между множествами ---
+TEST(SetPredicateTest, WarmIndexAllocatesNothing) {
+    std::string text = "{";
+    for (int i = 0; i < 200; ++i) {
+        text += "a" + std::to_string(i) + ", {n" + std::to_string(i) + ", {x, y}}, ";
+    }
+    text += "z}";
+    // Отдельный разбор даёт равные вложенные элементы в разных узлах
+    const Set larger(text);
+    const Set smaller(Set(text).difference(Set("{z}")));
+    const Set other("{b0, b1, b2, b3, b4, b5, b6, b7, b8, b9, b10, b11, b12, b13, b14, b15, b16, {b}}");
+    ASSERT_TRUE(smaller.isSubsetOf(larger));
+    ASSERT_TRUE(other.isDisjointFrom(larger));
+    AllocationCounter::reset();
+    EXPECT_TRUE(smaller.isSubsetOf(larger));
+    EXPECT_FALSE(larger.isSubsetOf(smaller));
+    EXPECT_TRUE(other.isDisjointFrom(larger));
+    EXPECT_FALSE(smaller.isDisjointFrom(larger));
+    EXPECT_EQ(AllocationCounter::allocations(), 0u);
+}
+
+TEST(SetPredicateTest, SmallSets) {
+    const Set set("{a, {b, c}, d}");
+    EXPECT_TRUE(Set("{{c, b}, a}").isSubsetOf(set));
+    EXPECT_FALSE(Set("{{c}, a}").isSubsetOf(set));
+    EXPECT_TRUE(set.isSupersetOf(Set("{d}")));
+    EXPECT_TRUE(Set().isSubsetOf(set));
+    EXPECT_TRUE(set.isSubsetOf(set));
+    EXPECT_FALSE(set.isSubsetOf(Set("{a, d}")));
+    EXPECT_FALSE(set.isSubsetOf(Set("{a, {b}, d}")));
+    EXPECT_TRUE(set.isDisjointFrom(Set("{b, c, {b}}")));
+    EXPECT_FALSE(set.isDisjointFrom(Set("{x, {c, b}}")));
+    EXPECT_TRUE(set.isDisjointFrom(Set()));
+    EXPECT_FALSE(set.isDisjointFrom(set));
+    EXPECT_EQ(set.intersectionSize(Set("{d, {b, c}, x}")), 2u);
+    EXPECT_EQ(set.intersectionSize(set), 3u);
+}
+
+TEST(SetPredicateTest, IndexedSets) {
+    const Set set(rangeElements(0, 1000));
+    const Set inner(rangeElements(100, 600));
+    const Set shifted(rangeElements(500, 1500));
+    EXPECT_TRUE(inner.isSubsetOf(set));
+    EXPECT_TRUE(set.isSupersetOf(inner));
+    EXPECT_FALSE(shifted.isSubsetOf(set));
+    EXPECT_EQ(set.intersectionSize(shifted), 500u);
+    EXPECT_EQ(shifted.intersectionSize(set), 500u);
+    EXPECT_FALSE(set.isDisjointFrom(shifted));
+    EXPECT_TRUE(inner.isDisjointFrom(Set(rangeElements(1000, 2000))));
+    EXPECT_TRUE(set.isSubsetOf(Set(rangeElements(0, 1000))));
+    // Индекс отпечатков сбрасывается при изменении множества
+    Set changing(rangeElements(0, 1000));
+    EXPECT_TRUE(inner.isSubsetOf(changing));
+    changing.erase(Set::Element("a101"));
+    EXPECT_FALSE(inner.isSubsetOf(changing));
+    changing.insert(Set::Element("a101"));
+    EXPECT_TRUE(inner.isSubsetOf(changing));
+}
+
+TEST(SetPredicateTest, NestedFingerprints) {
+    // Порядок и повторы детей не меняют ни отпечаток, ни равенство
+    const Set::Element ordered(std::vector<Set::Element>{Set::Element("a"), Set::Element("b")});
+    const Set::Element reversed(std::vector<Set::Element>{Set::Element("b"), Set::Element("a"), Set::Element("b")});
+    const Set::Element other(std::vector<Set::Element>{Set::Element("a"), Set::Element("c")});
+    EXPECT_EQ(ordered.subset.fingerprint(), reversed.subset.fingerprint());
+    EXPECT_TRUE(ordered == reversed);
+    EXPECT_FALSE(ordered == other);
+    EXPECT_EQ(Set::ElementHash()(ordered), Set::ElementHash()(reversed));
+    const Set::Element deep(std::vector<Set::Element>{ordered, Set::Element("z")});
+    const Set::Element deepReversed(std::vector<Set::Element>{Set::Element("z"), reversed, ordered});
+    EXPECT_TRUE(deep == deepReversed);
+    EXPECT_TRUE(Set(std::vector<Set::Element>{deep}).isSubsetOf(Set(std::vector<Set::Element>{Set::Element("q"), deepReversed})));
+}
+
+// --- Хранилище канонических вложенных множеств ---
+TEST(SubsetStoreTest, EqualSubsetsShareOneNode) {
+    SubsetStore store;
+    const Set::Element first(std::vector<Set::Element>{Set::Element("a"), Set::Element("b")});
+    const Set::Element second(std::vector<Set::Element>{Set::Element("b"), Set::Element("a"), Set::Element("a")});
+    const Set::Element other(std::vector<Set::Element>{Set::Element("c")});
+    const Set::Element canonicalFirst = store.intern(first);
+    const Set::Element canonicalSecond = store.intern(second);
+    const Set::Element canonicalOther = store.intern(other);
+    EXPECT_TRUE(canonicalFirst.subset.sharesNodeWith(canonicalSecond.subset));
+    // Первый представитель становится каноническим без копирования
+    EXPECT_TRUE(canonicalFirst.subset.sharesNodeWith(first.subset));
+    EXPECT_EQ(canonicalFirst.subset.store(), &store);
+    EXPECT_EQ(first.subset.store(), &store);
+    EXPECT_EQ(second.subset.store(), nullptr);
+    EXPECT_FALSE(canonicalFirst == canonicalOther);
+    EXPECT_TRUE(canonicalSecond == second);
+    EXPECT_EQ(store.size(), 2u);
+    EXPECT_EQ(store.intern(Set::Element("a")), Set::Element("a"));
+}
+
+TEST(SubsetStoreTest, ChildrenAreCanonicalized) {
+    SubsetStore store;
+    const Set::Element inner(std::vector<Set::Element>{Set::Element("x"), Set::Element("y")});
+    const Set::Element innerCopy(std::vector<Set::Element>{Set::Element("y"), Set::Element("x")});
+    const Set::Element outer(std::vector<Set::Element>{innerCopy, Set::Element("z")});
+    store.intern(inner);
+    const Set::Element canonical = store.intern(outer);
+    // Ребёнок заменён каноническим узлом, поэтому родитель скопирован
+    EXPECT_FALSE(canonical.subset.sharesNodeWith(outer.subset));
+    EXPECT_TRUE(canonical.subset[0].subset.sharesNodeWith(inner.subset));
+    EXPECT_TRUE(canonical == outer);
+    EXPECT_EQ(store.size(), 2u);
+    // Глубокая вложенность обходится без рекурсии
+    Set::Element deep("leaf");
+    for (int i = 0; i < 10000; ++i) {
+        deep = Set::Element(std::vector<Set::Element>{deep});
+    }
+    EXPECT_TRUE(store.intern(deep) == deep);
+    EXPECT_EQ(store.size(), 10002u);
+}
+
+TEST(SubsetStoreTest, InternNestedAndPowerSet) {
+    SubsetStore store;
+    Set left("{{a, b}, c, {d}}");
+    Set right("{{b, a}, {d}, e}");
+    left.internNested(store);
+    right.internNested(store);
+    EXPECT_EQ(left, Set("{{a, b}, c, {d}}"));
+    EXPECT_TRUE(left.begin()->subset.sharesNodeWith(right.begin()->subset));
+    EXPECT_EQ(right.serialize(), "{{a, b}, {d}, e}");
+    EXPECT_EQ(left.intersect(right), Set("{{a, b}, {d}}"));
+    const Set power = Set("{a, b, c}").powerSet(store);
+    const Set shifted = Set("{a, b, d}").powerSet(store);
+    EXPECT_EQ(power, Set("{a, b, c}").powerSet());
+    EXPECT_EQ(power.intersectionSize(shifted), 4u);
+    std::size_t shared = 0;
+    for (const auto& subset : power) {
+        for (const auto& candidate : shifted) {
+            if (!subset.subset.empty() && subset.subset.sharesNodeWith(candidate.subset)) ++shared;
+        }
+    }
+    EXPECT_EQ(shared, 3u);
+    std::pmr::monotonic_buffer_resource arena;
+    Set foreign(Set("{{a}}"), &arena);
+    EXPECT_THROW(foreign.internNested(store), std::invalid_argument);
+}
+
+TEST(SubsetStoreTest, DestroyedStoreReleasesTags) {
+    Set::Element first(std::vector<Set::Element>{Set::Element("a")});
+    Set::Element second(std::vector<Set::Element>{Set::Element("b")});
+    {
+        SubsetStore store;
+        first = store.intern(first);
+        second = store.intern(second);
+        EXPECT_FALSE(first == second);
+    }
+    EXPECT_EQ(first.subset.store(), nullptr);
+    EXPECT_TRUE(first == Set::Element(std::vector<Set::Element>{Set::Element("a")}));
+}
+
+// --- Индексированный файл множества ---
+namespace {
+
+std::string temporarySetFile() {
+    char path[] = "/tmp/set_file_testXXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    return path;
+}
+
+}
+
+TEST(SetFileTest, RandomAccessRoundTrip) {
+    const std::string path = temporarySetFile();
+    const Set set("{a, {b, c}, {}, {d, {e, f}}, g}");
+    for (bool compress : {true, false}) {
+        SetFile::write(set, path, compress);
+        SetFile file(path);
+        ASSERT_EQ(file.size(), set.size());
+        EXPECT_EQ(file.chunkCount(), 1u);
+        for (std::size_t i = 0; i < set.size(); ++i) {
+            EXPECT_EQ(file.fetch(i), *(set.begin() + static_cast<std::ptrdiff_t>(i)));
+        }
+        EXPECT_TRUE(file.contains(Set::Element("g")));
+        EXPECT_TRUE(file.contains(Set("{{{f, e}, d}}").begin()[0]));
+        EXPECT_TRUE(file.contains(Set::Element(std::vector<Set::Element>())));
+        EXPECT_FALSE(file.contains(Set::Element("b")));
+        EXPECT_FALSE(file.contains(Set("{{b}}").begin()[0]));
+        EXPECT_THROW(file.fetch(set.size()), std::out_of_range);
+        EXPECT_EQ(file.load(), set);
+        EXPECT_NO_THROW(file.verify());
+    }
+    std::remove(path.c_str());
+}
+
+TEST(SetFileTest, ManyChunks) {
+    const std::string path = temporarySetFile();
+    const Set set(rangeElements(0, 30000));
+    SetFile::write(set, path);
+    SetFile file(path);
+    EXPECT_GT(file.chunkCount(), 1u);
+    EXPECT_EQ(file.size(), 30000u);
+    EXPECT_TRUE(file.contains(Set::Element("a29999")));
+    EXPECT_TRUE(file.contains(Set::Element(std::vector<Set::Element>{Set::Element("x"), Set::Element("n100")})));
+    EXPECT_FALSE(file.contains(Set::Element("a30000")));
+    EXPECT_EQ(file.fetch(12345), set.begin()[12345]);
+    std::size_t visited = 0;
+    file.forEach([&](const Set::Element& element) {
+        EXPECT_EQ(element, set.begin()[static_cast<std::ptrdiff_t>(visited)]);
+        ++visited;
+    });
+    EXPECT_EQ(visited, set.size());
+    EXPECT_NO_THROW(file.verify());
+    std::remove(path.c_str());
+}
+
+TEST(SetFileTest, DeepNesting) {
+    const std::string path = temporarySetFile();
+    const std::size_t depth = 100000;
+    const Set set(std::string(depth, '{') + "a" + std::string(depth, '}'));
+    SetFile::write(set, path);
+    SetFile file(path);
+    EXPECT_TRUE(file.contains(*set.begin()));
+    EXPECT_FALSE(file.contains(*Set(std::string(depth, '{') + "b" + std::string(depth, '}')).begin()));
+    EXPECT_EQ(file.fetch(0), *set.begin());
+    EXPECT_EQ(file.load(), set);
+    std::remove(path.c_str());
+}
+
+TEST(SetFileTest, EmptySet) {
+    const std::string path = temporarySetFile();
+    SetFile::write(Set(), path);
+    SetFile file(path);
+    EXPECT_TRUE(file.empty());
+    EXPECT_EQ(file.chunkCount(), 0u);
+    EXPECT_FALSE(file.contains(Set::Element("a")));
+    EXPECT_TRUE(file.load().isEmpty());
+    std::remove(path.c_str());
+}
+
+TEST(SetFileTest, RejectsDamagedFiles) {
+    const std::string path = temporarySetFile();
+    EXPECT_THROW(SetFile("/nonexistent/set_file"), std::runtime_error);
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "{a, b}";
+    }
+    EXPECT_THROW(SetFile file(path), std::invalid_argument);
+    SetFile::write(Set(rangeElements(0, 1000)), path, false);
+    {
+        // Порча байта в блоке находится полной проверкой
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(100);
+        file.put('\x7f');
+    }
+    SetFile damaged(path);
+    EXPECT_THROW(damaged.verify(), std::invalid_argument);
+    std::remove(path.c_str());
+}
+
 // --- Главная функция ---
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);